@@ -18,6 +18,9 @@
 
 // ------------------------------
 // Dependencies
+#include <algorithm>
+#include <numeric>
+
 #include "experiments.hpp"
 #include "adapter_arrow.hpp"
 
@@ -27,9 +30,47 @@
 using arrow::fs::FileSystemFromUri;
 
 
+// ------------------------------
+// Variables
+
+// message of the status that `ReadBatchesFromTable` returns once its reader is exhausted
+static const std::string end_of_batches_msg { "No more record batches" };
+
+
 // ------------------------------
 // Convenience Functions
 
+Result<IOStrategy>
+IOStrategyFromName(const string &strategy_name) {
+  if      (strategy_name == "read"    ) { return IOStrategy::Read;         }
+  else if (strategy_name == "mmap"    ) { return IOStrategy::Mmap;         }
+  else if (strategy_name == "prefetch") { return IOStrategy::MmapPrefetch; }
+
+  return Status::Invalid("Unknown IO strategy: '", strategy_name, "'");
+}
+
+const char*
+IOStrategyName(IOStrategy io_strategy) {
+  switch (io_strategy) {
+    case IOStrategy::Read:         return "read";
+    case IOStrategy::Mmap:         return "mmap";
+    case IOStrategy::MmapPrefetch: return "prefetch";
+  }
+
+  return "unknown";
+}
+
+ReadProjection
+ProjectKeyAndColumns(int64_t col_limit) {
+  ReadProjection projection;
+  if (col_limit <= 0) { return projection; }
+
+  projection.col_indices.resize(col_limit + 1);
+  std::iota(projection.col_indices.begin(), projection.col_indices.end(), 0);
+
+  return projection;
+}
+
 void
 PrintSchemaAttributes(shared_ptr<Schema> schema, int64_t offset, int64_t length) {
     bool    show_field_meta = true;
@@ -154,34 +195,310 @@ PrintBatch(shared_ptr<RecordBatch> batch_data, int64_t offset, int64_t length) {
 }
 
 
-// this Reader is arrow::ipc::feather::Reader
-Result<shared_ptr<Reader>>
-ReaderForIPCFile(const string &path_as_uri) {
+Result<std::vector<string>>
+SplitList(const string &list_str) {
+  std::vector<string> list_vals;
+
+  size_t val_start = 0;
+  while (val_start <= list_str.size()) {
+    size_t val_stop = list_str.find(',', val_start);
+    if (val_stop == string::npos) { val_stop = list_str.size(); }
+
+    if (val_stop > val_start) {
+      list_vals.push_back(list_str.substr(val_start, val_stop - val_start));
+    }
+
+    val_start = val_stop + 1;
+  }
+
+  if (list_vals.empty()) { return Status::Invalid("Empty list: '", list_str, "'"); }
+  return list_vals;
+}
+
+string
+UriForPath(const std::filesystem::path &file_path) {
+  return "file://" + std::filesystem::absolute(file_path).string();
+}
+
+WriteProperties
+UncompressedWriteProps(int64_t chunk_rows) {
+  auto write_props        = WriteProperties::Defaults();
+  write_props.compression = arrow::Compression::UNCOMPRESSED;
+  write_props.chunksize   = chunk_rows;
+
+  return write_props;
+}
+
+int64_t
+SourceChunkRows(const Table &src_table) {
+  if (src_table.num_columns() > 0 and src_table.column(0)->num_chunks() > 0) {
+    int64_t chunk_rows = src_table.column(0)->chunk(0)->length();
+    if (chunk_rows > 0) { return chunk_rows; }
+  }
+
+  if (src_table.num_rows() > 0) { return src_table.num_rows(); }
+  return WriteProperties::Defaults().chunksize;
+}
+
+/**
+ * Open a handle to the file at `path_as_uri` using `io_strategy`. Memory mapping needs a
+ * path on the local filesystem, so other URI schemes only support `IOStrategy::Read`.
+ */
+Result<shared_ptr<RandomAccessFile>>
+OpenIPCInput(const string &path_as_uri, IOStrategy io_strategy) {
   string path_to_file;
 
   // get a `FileSystem` instance (local fs scheme is "file://")
   ARROW_ASSIGN_OR_RAISE(auto localfs, FileSystemFromUri(path_as_uri, &path_to_file));
 
   // use the `FileSystem` instance to open a handle to the file
-  ARROW_ASSIGN_OR_RAISE(auto input_file_stream, localfs->OpenInputFile(path_to_file));
+  if (io_strategy == IOStrategy::Read) { return localfs->OpenInputFile(path_to_file); }
+
+  if (localfs->type_name() != "local") {
+    return Status::NotImplemented(
+      "Memory mapping requires a local file, not: '", path_as_uri, "'"
+    );
+  }
 
-  return Reader::Open(input_file_stream);
+  ARROW_ASSIGN_OR_RAISE(
+     auto mapped_file
+    ,MemoryMappedFile::Open(path_to_file, arrow::io::FileMode::READ)
+  );
+
+  if (io_strategy == IOStrategy::MmapPrefetch) {
+    ARROW_ASSIGN_OR_RAISE(auto file_size, mapped_file->GetSize());
+    ARROW_RETURN_NOT_OK(mapped_file->WillNeed({ { 0, file_size } }));
+  }
+
+  return mapped_file;
+}
+
+
+/**
+ * Options for every IPC reader here. Files may be LZ4 or ZSTD compressed (per buffer);
+ * with `use_threads`, the buffers of a record batch are decompressed in parallel on
+ * arrow's CPU thread pool, so decode parallelism follows that pool's capacity. When
+ * streaming with a `SlicePrefetcher`, decompression also overlaps with aggregation.
+ */
+static IpcReadOptions
+IPCReadOptions() {
+  auto read_opts        = IpcReadOptions::Defaults();
+  read_opts.use_threads = true;
+
+  return read_opts;
+}
+
+
+// this Reader is arrow::ipc::feather::Reader
+Result<shared_ptr<Reader>>
+ReaderForIPCFile(const string &path_as_uri, IOStrategy io_strategy) {
+  ARROW_ASSIGN_OR_RAISE(auto input_file, OpenIPCInput(path_as_uri, io_strategy));
+
+  return Reader::Open(input_file, IPCReadOptions());
+}
+
+
+// >> Projected reads
+
+// Open a `RecordBatchFileReader` that only decodes the columns selected by `projection`.
+// The indices go to `Open` as given, so the footer (and schema) is read once. `Open`
+// rejects an index past the last column; only then is the projection limited to the
+// schema of that (unprojected) reader and opened again.
+static Result<shared_ptr<arrow::ipc::RecordBatchFileReader>>
+ProjectedFileReader( const shared_ptr<RandomAccessFile> &input_file
+                    ,const ReadProjection               &projection) {
+  auto read_opts = IPCReadOptions();
+  if (projection.AllColumns()) { return arrow::ipc::RecordBatchFileReader::Open(input_file, read_opts); }
+
+  int max_colndx = -1;
+  for (int col_ndx : projection.col_indices) {
+    if (col_ndx < 0) { continue; }
+
+    read_opts.included_fields.push_back(col_ndx);
+    max_colndx = std::max(max_colndx, col_ndx);
+  }
+
+  auto file_reader = arrow::ipc::RecordBatchFileReader::Open(input_file, read_opts);
+  if (file_reader.ok() or max_colndx < 0) { return file_reader; }
+
+  // >> some index is past the last column (or the file can't be read at all)
+  ARROW_ASSIGN_OR_RAISE(auto schema_reader, arrow::ipc::RecordBatchFileReader::Open(input_file));
+
+  int field_count = schema_reader->schema()->num_fields();
+  if (max_colndx < field_count) { return file_reader; }
+
+  auto &included_fields = read_opts.included_fields;
+  included_fields.erase(
+     std::remove_if(
+        included_fields.begin(), included_fields.end()
+       ,[field_count](int col_ndx) { return col_ndx >= field_count; }
+     )
+    ,included_fields.end()
+  );
+
+  return arrow::ipc::RecordBatchFileReader::Open(input_file, read_opts);
+}
+
+// The half-open range of record batch indices selected by `projection`; it is an error
+// for the range to be empty
+static Result<std::pair<int, int>>
+ProjectedBatchRange( const shared_ptr<arrow::ipc::RecordBatchFileReader> &file_reader
+                    ,const ReadProjection                                &projection) {
+  int batch_count = file_reader->num_record_batches();
+  int batch_start = std::min(std::max(projection.batch_startndx, 0), batch_count);
+  int batch_stop  = batch_count;
+
+  if (projection.batch_limit > 0) {
+    batch_stop = std::min(batch_start + projection.batch_limit, batch_count);
+  }
+
+  if (batch_start >= batch_stop) {
+    return Status::IndexError(
+      "Batch range [", projection.batch_startndx, ":", projection.batch_limit, "]"
+      " selects none of the ", batch_count, " record batches"
+    );
+  }
+
+  return std::make_pair(batch_start, batch_stop);
 }
 
 
 Result<shared_ptr<Table>>
-ReadIPCFile(const string& path_to_file) {
+ReadIPCFile( const string         &path_to_file
+            ,IOStrategy            io_strategy
+            ,const ReadProjection &projection) {
   shared_ptr<Table> data_table;
 
-  ARROW_ASSIGN_OR_RAISE(auto feather_reader, ReaderForIPCFile(path_to_file));
-  ARROW_RETURN_NOT_OK(feather_reader->Read(&data_table));
+  if (projection.AllColumns() and projection.AllBatches()) {
+    ARROW_ASSIGN_OR_RAISE(auto feather_reader, ReaderForIPCFile(path_to_file, io_strategy));
+    ARROW_RETURN_NOT_OK(feather_reader->Read(&data_table));
+
+    return data_table;
+  }
+
+  // Read only the selected batches, and only the selected columns of each
+  ARROW_ASSIGN_OR_RAISE(auto input_file , OpenIPCInput(path_to_file, io_strategy));
+  ARROW_ASSIGN_OR_RAISE(auto file_reader, ProjectedFileReader(input_file, projection));
+
+  ARROW_ASSIGN_OR_RAISE(auto batch_range, ProjectedBatchRange(file_reader, projection));
+  auto [batch_start, batch_stop] = batch_range;
 
-  return data_table;
+  RecordBatchVector batch_list;
+  batch_list.reserve(batch_stop - batch_start);
+  for (int batch_ndx = batch_start; batch_ndx < batch_stop; ++batch_ndx) {
+    ARROW_ASSIGN_OR_RAISE(auto batch_data, file_reader->ReadRecordBatch(batch_ndx));
+    batch_list.push_back(std::move(batch_data));
+  }
+
+  return Table::FromRecordBatches(file_reader->schema(), batch_list);
 }
 
 
+// Write `table_data` as a feather (IPC) file; chunking and compression are in `write_props`
+Status
+WriteIPCFile( const string          &path_as_uri
+             ,shared_ptr<Table>      table_data
+             ,const WriteProperties &write_props) {
+  string path_to_file;
+
+  ARROW_ASSIGN_OR_RAISE(auto localfs    , FileSystemFromUri(path_as_uri, &path_to_file));
+  ARROW_ASSIGN_OR_RAISE(auto output_file, localfs->OpenOutputStream(path_to_file));
+  ARROW_RETURN_NOT_OK(arrow::ipc::feather::WriteTable(*table_data, output_file.get(), write_props));
+
+  return output_file->Close();
+}
+
 Result<shared_ptr<Table>>
-ReadBatchesFromTable(arrow::TableBatchReader &reader, size_t batch_count) {
+RewriteIPCFile( const string         &src_uri
+               ,const string         &dst_uri
+               ,const TableTransform &transform_table) {
+  ARROW_ASSIGN_OR_RAISE(auto src_table, ReadIPCFile(src_uri));
+  ARROW_ASSIGN_OR_RAISE(auto dst_table, transform_table(src_table));
+
+  // keep the source's record batch size; leave buffers uncompressed so they can be mapped
+  ARROW_RETURN_NOT_OK(
+    WriteIPCFile(dst_uri, dst_table, UncompressedWriteProps(SourceChunkRows(*src_table)))
+  );
+
+  return dst_table;
+}
+
+
+/**
+ * Stream RecordBatches from an IPC file through an acero plan (source -> sink), instead
+ * of reading the whole file into a Table first. Batches are read asynchronously, so the
+ * consumer can start on the first batch while later batches are still being read.
+ * `row_count` (if not null) is set from the file's metadata, without reading any batches.
+ *
+ * When `projection` selects a range of batches, the selected batches are read one at a
+ * time, in order, and `row_count` is summed from those batches' key column only.
+ */
+Result<unique_ptr<RecordBatchReader>>
+StreamIPCFile( const string         &path_as_uri
+              ,int64_t              *row_count
+              ,IOStrategy            io_strategy
+              ,const ReadProjection &projection) {
+  ARROW_ASSIGN_OR_RAISE(auto input_file , OpenIPCInput(path_as_uri, io_strategy));
+  ARROW_ASSIGN_OR_RAISE(auto file_reader, ProjectedFileReader(input_file, projection));
+
+  std::function<arrow::Future<shared_ptr<RecordBatch>>()> batch_gen;
+  if (projection.AllBatches()) {
+    if (row_count != nullptr) {
+      ARROW_ASSIGN_OR_RAISE(*row_count, file_reader->CountRows());
+    }
+
+    ARROW_ASSIGN_OR_RAISE(batch_gen, file_reader->GetRecordBatchGenerator());
+  }
+
+  else {
+    ARROW_ASSIGN_OR_RAISE(auto batch_range, ProjectedBatchRange(file_reader, projection));
+    int batch_start = batch_range.first;
+    int batch_stop  = batch_range.second;
+
+    if (row_count != nullptr) {
+      ARROW_ASSIGN_OR_RAISE(auto key_reader, ProjectedFileReader(input_file, ReadProjection { {0} }));
+
+      *row_count = 0;
+      for (int batch_ndx = batch_start; batch_ndx < batch_stop; ++batch_ndx) {
+        ARROW_ASSIGN_OR_RAISE(auto key_batch, key_reader->ReadRecordBatch(batch_ndx));
+        *row_count += key_batch->num_rows();
+      }
+    }
+
+    // a null batch ends the stream
+    batch_gen = [file_reader, batch_ndx = batch_start, batch_stop]() mutable {
+      if (batch_ndx >= batch_stop) {
+        return arrow::Future<shared_ptr<RecordBatch>>::MakeFinished(
+          shared_ptr<RecordBatch> { nullptr }
+        );
+      }
+
+      return arrow::Future<shared_ptr<RecordBatch>>::MakeFinished(
+        file_reader->ReadRecordBatch(batch_ndx++)
+      );
+    };
+  }
+
+  // the source node consumes ExecBatches; keep `file_reader` alive with the generator
+  auto exec_gen = arrow::MakeMappedGenerator(
+     std::move(batch_gen)
+    ,[file_reader](const shared_ptr<RecordBatch> &batch) {
+       return std::optional<arrow::compute::ExecBatch> { arrow::compute::ExecBatch(*batch) };
+     }
+  );
+
+  arrow::acero::Declaration stream_plan {
+     "source"
+    ,arrow::acero::SourceNodeOptions { file_reader->schema(), std::move(exec_gen) }
+  };
+
+  // a single thread keeps batches in file order, which `SliceAggr` relies on
+  return arrow::acero::DeclarationToReader(std::move(stream_plan), /*use_threads=*/ false);
+}
+
+
+Result<shared_ptr<Table>>
+ReadBatchesFromTable(RecordBatchReader &reader, size_t batch_count) {
   vector<shared_ptr<RecordBatch>> batch_list;
 
   shared_ptr<RecordBatch> curr_batch;
@@ -192,7 +509,109 @@ ReadBatchesFromTable(arrow::TableBatchReader &reader, size_t batch_count) {
     batch_list.push_back(curr_batch);
   }
 
+  if (batch_list.empty()) { return Status::IndexError(end_of_batches_msg); }
+
   ARROW_ASSIGN_OR_RAISE(auto table_chunk, Table::FromRecordBatches(batch_list));
 
   return table_chunk->CombineChunks();
 }
+
+bool
+IsEndOfBatches(const Status &read_status) {
+  return read_status.IsIndexError() and read_status.message() == end_of_batches_msg;
+}
+
+
+Result<shared_ptr<Buffer>>
+WriteTableToBuffer(shared_ptr<Table> table_data) {
+  ARROW_ASSIGN_OR_RAISE(auto buffer_stream, BufferOutputStream::Create());
+  ARROW_ASSIGN_OR_RAISE(
+     auto stream_writer
+    ,arrow::ipc::MakeStreamWriter(buffer_stream, table_data->schema())
+  );
+
+  ARROW_RETURN_NOT_OK(stream_writer->WriteTable(*table_data));
+  ARROW_RETURN_NOT_OK(stream_writer->Close());
+
+  return buffer_stream->Finish();
+}
+
+Result<shared_ptr<Table>>
+ReadTableFromBuffer(shared_ptr<Buffer> table_buffer) {
+  auto buffer_stream = std::make_shared<BufferReader>(table_buffer);
+  ARROW_ASSIGN_OR_RAISE(auto stream_reader, RecordBatchStreamReader::Open(buffer_stream));
+
+  return stream_reader->ToTable();
+}
+
+
+// >> SlicePrefetcher
+
+SlicePrefetcher::SlicePrefetcher( RecordBatchReader &reader
+                                 ,size_t             batch_count
+                                 ,size_t             qdepth)
+  : reader(reader), batch_count(batch_count), qdepth(std::max<size_t>(qdepth, 1)) {
+  // start the thread last, once every member it touches is initialized
+  read_thread = std::thread(&SlicePrefetcher::ReadSlices, this);
+}
+
+SlicePrefetcher::~SlicePrefetcher() {
+  {
+    std::lock_guard<std::mutex> queue_guard { queue_lock };
+    should_stop = true;
+  }
+
+  queue_notfull.notify_all();
+  read_thread.join();
+}
+
+void
+SlicePrefetcher::ReadSlices() {
+  while (true) {
+    auto read_tstart = std::chrono::steady_clock::now();
+    auto slice_data  = ReadBatchesFromTable(reader, batch_count);
+    auto read_tstop  = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> queue_guard { queue_lock };
+    queue_notfull.wait(queue_guard, [this] {
+      return should_stop or slice_queue.size() < qdepth;
+    });
+
+    read_time.busy += read_tstop - read_tstart;
+    read_time.idle += std::chrono::steady_clock::now() - read_tstop;
+    if (should_stop) { return; }
+
+    // the final entry is the error that ends the slices
+    bool is_last = not slice_data.ok();
+    slice_queue.push_back(std::move(slice_data));
+
+    queue_guard.unlock();
+    queue_notempty.notify_one();
+
+    if (is_last) { return; }
+  }
+}
+
+Result<shared_ptr<Table>>
+SlicePrefetcher::Next() {
+  auto wait_tstart = std::chrono::steady_clock::now();
+
+  std::unique_lock<std::mutex> queue_guard { queue_lock };
+  queue_notempty.wait(queue_guard, [this] { return not slice_queue.empty(); });
+  wait_time += std::chrono::steady_clock::now() - wait_tstart;
+
+  // leave the final error queued, so that every later call returns it too
+  auto slice_data = slice_queue.front();
+  if (slice_data.ok()) { slice_queue.pop_front(); }
+
+  queue_guard.unlock();
+  queue_notfull.notify_one();
+
+  return slice_data;
+}
+
+StageTime
+SlicePrefetcher::ReadTime() {
+  std::lock_guard<std::mutex> queue_guard { queue_lock };
+  return read_time;
+}
@@ -21,6 +21,14 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <filesystem>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 
 // >> Arrow dependencies
 #include <arrow/api.h>
@@ -29,6 +37,8 @@
 #include <arrow/dataset/api.h>
 #include <arrow/compute/api.h>
 #include <arrow/filesystem/api.h>
+#include <arrow/acero/api.h>
+#include <arrow/util/async_generator.h>
 
 
 // ------------------------------
@@ -51,6 +61,7 @@ using arrow::Schema;
 using KVMetadata = arrow::KeyValueMetadata;
 using arrow::Table;
 using arrow::RecordBatch;
+using arrow::RecordBatchReader;
 
 // >> Arrow vector aliases
 using arrow::ArrayVector;
@@ -59,6 +70,7 @@ using arrow::RecordBatchVector;
 // >> Arrow low-level and meta types
 using arrow::DataType;
 using arrow::Buffer;
+using arrow::MemoryPool;
 
 // >> Arrow array types
 using arrow::Int32Array;
@@ -74,10 +86,88 @@ using arrow::io::BufferOutputStream;
 
 // >> Arrow filesystem types
 using arrow::io::RandomAccessFile;
+using arrow::io::MemoryMappedFile;
 using arrow::fs::FileSystem;
 using arrow::ipc::RecordBatchStreamReader;
 using arrow::ipc::IpcReadOptions;
 using arrow::ipc::feather::Reader;
+using arrow::ipc::feather::WriteProperties;
+
+
+// ------------------------------
+// Classes and structs
+
+// How an IPC file is brought into memory:
+//  - Read        : `FileSystem::OpenInputFile`; column buffers are copied into heap memory
+//  - Mmap        : `MemoryMappedFile`; uncompressed column buffers point into the mapping
+//                  (zero copy) and pages fault in on first touch
+//  - MmapPrefetch: as Mmap, then madvise(WILLNEED) over the whole file so the kernel
+//                  starts reading pages ahead of the first access
+enum class IOStrategy { Read, Mmap, MmapPrefetch };
+
+Result<IOStrategy> IOStrategyFromName(const std::string &strategy_name);
+const char*        IOStrategyName(IOStrategy io_strategy);
+
+// Which columns and record batches of an IPC file to read. Only the selected column
+// buffers and batches are read (or, when mapped, touched). Empty `col_indices` selects
+// every column; indices past the last column are ignored. `batch_limit` <= 0 selects
+// every batch from `batch_startndx` to the end of the file.
+struct ReadProjection {
+  std::vector<int> col_indices;
+  int              batch_startndx { 0 };
+  int              batch_limit    { 0 };
+
+  bool AllColumns() const { return col_indices.empty();                      }
+  bool AllBatches() const { return batch_startndx == 0 and batch_limit <= 0; }
+};
+
+// Projection of the key column (index 0) and the `col_limit` columns after it, which is
+// what `AggrTable` and `SliceAggr` aggregate. `col_limit` <= 0 selects every column.
+ReadProjection ProjectKeyAndColumns(int64_t col_limit);
+
+
+// Time a pipeline stage spent working vs waiting on its neighbor stage
+struct StageTime {
+  std::chrono::nanoseconds busy { 0 };
+  std::chrono::nanoseconds idle { 0 };
+};
+
+// Reads slices of `batch_count` batches (see `ReadBatchesFromTable`) on a background
+// thread into a queue of at most `qdepth` slices, so reading and decoding the next slices
+// overlaps with aggregating the current one. `Next` blocks until a slice is ready; once
+// `reader` is exhausted (or fails) it returns that error, like `ReadBatchesFromTable`; use
+// `IsEndOfBatches` to tell the end of `reader` from a failed read.
+// `reader` must outlive the prefetcher, and must not be used by anything else meanwhile.
+class SlicePrefetcher {
+  public:
+    SlicePrefetcher(RecordBatchReader &reader, size_t batch_count, size_t qdepth);
+    ~SlicePrefetcher();
+
+    Result<shared_ptr<Table>> Next();
+
+    // reader: busy reading slices, idle while the queue is full
+    StageTime                ReadTime();
+
+    // total time `Next` blocked on an empty queue
+    std::chrono::nanoseconds WaitTime() const { return wait_time; }
+
+  private:
+    void ReadSlices();
+
+    RecordBatchReader &reader;
+    size_t             batch_count;
+    size_t             qdepth;
+
+    std::mutex                            queue_lock;
+    std::condition_variable               queue_notfull;
+    std::condition_variable               queue_notempty;
+    std::deque<Result<shared_ptr<Table>>> slice_queue;
+    bool                                  should_stop { false };
+
+    StageTime                read_time;
+    std::chrono::nanoseconds wait_time { 0 };
+    std::thread              read_thread;
+};
 
 
 // ------------------------------
@@ -90,8 +180,65 @@ void PrintSchema(shared_ptr<Schema>     schema    , int64_t offset, int64_t leng
 void PrintTable(shared_ptr<Table>       table_data, int64_t offset, int64_t length);
 void PrintBatch(shared_ptr<RecordBatch> batch_data, int64_t offset, int64_t length);
 
-Result<shared_ptr<Reader>> ReaderForIPCFile(const std::string &path_as_uri);
-Result<shared_ptr<Table>>  ReadIPCFile(const std::string& path_to_file);
+// Items of a comma-separated list (e.g. a CLI option), without empty items; Invalid if
+// there are none
+Result<std::vector<std::string>> SplitList(const std::string &list_str);
+
+// "file://" URI of a local path; a relative path is resolved against the working directory
+std::string UriForPath(const std::filesystem::path &file_path);
+
+// For files that are mapped or rewritten by the tools: uncompressed, so column buffers can
+// be used in place, in record batches of `chunk_rows` rows
+WriteProperties UncompressedWriteProps(int64_t chunk_rows);
+
+// Rows per record batch of `src_table` (its first chunk), for rewriting it with the same
+// batch size. An empty first chunk or a table without chunks falls back to all of its rows,
+// or to the default chunk size when it has none
+int64_t SourceChunkRows(const Table &src_table);
+
+Result<shared_ptr<RandomAccessFile>>
+OpenIPCInput(const std::string &path_as_uri, IOStrategy io_strategy = IOStrategy::Read);
+
+Result<shared_ptr<Reader>>
+ReaderForIPCFile(const std::string &path_as_uri, IOStrategy io_strategy = IOStrategy::Read);
+
+Result<shared_ptr<Table>>
+ReadIPCFile( const std::string    &path_to_file
+            ,IOStrategy            io_strategy = IOStrategy::Read
+            ,const ReadProjection &projection  = ReadProjection{});
+
+Status
+WriteIPCFile( const std::string     &path_as_uri
+             ,shared_ptr<Table>      table_data
+             ,const WriteProperties &write_props = WriteProperties::Defaults());
+
+// Rewrites the IPC file at `src_uri` as `transform_table` of its table, at `dst_uri`, with
+// `UncompressedWriteProps` and the source's batch size. Returns the written table.
+using TableTransform = std::function<Result<shared_ptr<Table>>(shared_ptr<Table>)>;
+
+Result<shared_ptr<Table>>
+RewriteIPCFile( const std::string    &src_uri
+               ,const std::string    &dst_uri
+               ,const TableTransform &transform_table);
+
+Result<unique_ptr<RecordBatchReader>>
+StreamIPCFile( const std::string    &path_as_uri
+              ,int64_t              *row_count
+              ,IOStrategy            io_strategy = IOStrategy::Read
+              ,const ReadProjection &projection  = ReadProjection{});
+
+// Combines the next `batch_count` batches of `reader` into 1 table. Once `reader` is
+// exhausted, returns an error for which `IsEndOfBatches` is true; any other error is a
+// failure to read
+Result<shared_ptr<Table>>
+ReadBatchesFromTable(RecordBatchReader &reader, size_t batch_count);
+
+bool IsEndOfBatches(const Status &read_status);
+
+// IPC stream bytes of a table (schema, including metadata, then its record batches), e.g.
+// to store as a value in a key-value store. Decoding does not copy column buffers.
+Result<shared_ptr<Buffer>>
+WriteTableToBuffer(shared_ptr<Table> table_data);
 
 Result<shared_ptr<Table>>
-ReadBatchesFromTable(arrow::TableBatchReader &reader, size_t batch_count);
+ReadTableFromBuffer(shared_ptr<Buffer> table_buffer);
@@ -0,0 +1,241 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#include <getopt.h>
+#include <filesystem>
+#include <random>
+
+#include "experiments.hpp"
+
+
+// ------------------------------
+// Variables
+
+static std::string help_message {
+    "Usage: <all-pairs> [options] (-g <datasets> | -k <K>)\n"
+    "\tComputes the t-statistics of every pair of groups, where each group is the partial\n"
+    "\taggregate of a dataset in a partition store, or is synthetic. Results are written\n"
+    "\tto a feather file as they are computed, 1 record batch per set of pairs.\n"
+    "Options:\n"
+    "\t-s, --store <dir>      : partition store; see load-partition (default: store)\n"
+    "\t-d, --domain <name>    : key prefix of the datasets in the store\n"
+    "\t-g, --groups <a,b,...> : datasets, 1 group each; aligned to 'annotations/genes'\n"
+    "\t-k, --synthetic <K>    : instead, K groups of random means and variances\n"
+    "\t-n, --genes <N>        : genes per synthetic group (default: 27118)\n"
+    "\t-p, --pairs <N>        : pairs per record batch (default: 64)\n"
+    "\t-t, --tile-rows <N>    : genes per tile (default: 4096)\n"
+    "\t-j, --threads <N>      : gene ranges computed in parallel (default: 1)\n"
+    "\t-o, --output <path>    : feather file for the results (default: results are dropped)"
+};
+
+static const char *option_template = "s:d:g:k:n:p:t:j:o:";
+
+static const struct option option_longnames[] = {
+     { "store"    , required_argument, nullptr, 's' }
+    ,{ "domain"   , required_argument, nullptr, 'd' }
+    ,{ "groups"   , required_argument, nullptr, 'g' }
+    ,{ "synthetic", required_argument, nullptr, 'k' }
+    ,{ "genes"    , required_argument, nullptr, 'n' }
+    ,{ "pairs"    , required_argument, nullptr, 'p' }
+    ,{ "tile-rows", required_argument, nullptr, 't' }
+    ,{ "threads"  , required_argument, nullptr, 'j' }
+    ,{ "output"   , required_argument, nullptr, 'o' }
+    ,{ nullptr    , 0                , nullptr,  0  }
+};
+
+
+// ------------------------------
+// Functions
+
+// Each dataset's partial aggregate, aligned to the store's gene annotations
+static Status
+AddStoreGroups( PairwiseTStat     &pair_engine
+               ,const std::string &store_dirpath
+               ,const std::string &domain_key
+               ,const std::string &dataset_list) {
+    LocalDirStore store { store_dirpath };
+
+    ARROW_ASSIGN_OR_RAISE(auto gene_table, store.GetPartitionData("annotations/genes"));
+    ARROW_ASSIGN_OR_RAISE(auto gene_dict , GeneDictionary::FromTable(gene_table));
+
+    ARROW_ASSIGN_OR_RAISE(auto dataset_names, SplitList(dataset_list));
+    for (const auto &dataset_name : dataset_names) {
+        ARROW_ASSIGN_OR_RAISE(auto part_table, store.GetPartitionData(domain_key + "/" + dataset_name));
+        ARROW_ASSIGN_OR_RAISE(auto part_order, gene_dict.OrderFor(*part_table));
+        ARROW_ASSIGN_OR_RAISE(auto part_norm , CopyMatchedRows(part_order, part_table));
+
+        ARROW_ASSIGN_OR_RAISE(auto part_aggr, MeanAggr::FromStateTable(part_norm));
+
+        ARROW_RETURN_NOT_OK(pair_engine.AddGroup(dataset_name, part_aggr));
+    }
+
+    return Status::OK();
+}
+
+// `group_count` groups of `gene_count` random means and variances, with 10 to 200 samples
+static Status
+AddSyntheticGroups(PairwiseTStat &pair_engine, int64_t group_count, int64_t gene_count) {
+    std::mt19937_64                        rng { 42 };
+    std::normal_distribution<double>       mean_dist { 0.0, 1.0 };
+    std::uniform_real_distribution<double> var_dist  { 0.5, 2.0 };
+    std::uniform_int_distribution<int>     size_dist { 10 , 200 };
+
+    std::vector<double> group_means(gene_count);
+    std::vector<double> group_vars(gene_count);
+    for (int64_t group_ndx = 0; group_ndx < group_count; ++group_ndx) {
+        for (int64_t gene_ndx = 0; gene_ndx < gene_count; ++gene_ndx) {
+            group_means[gene_ndx] = mean_dist(rng);
+            group_vars[gene_ndx]  = var_dist(rng);
+        }
+
+        MeanAggr group_aggr;
+        group_aggr.count = static_cast<uint64_t>(size_dist(rng));
+
+        arrow::DoubleBuilder means_builder;
+        arrow::DoubleBuilder vars_builder;
+        ARROW_RETURN_NOT_OK(means_builder.AppendValues(group_means));
+        ARROW_RETURN_NOT_OK(vars_builder.AppendValues(group_vars));
+
+        ARROW_ASSIGN_OR_RAISE(auto means_array, means_builder.Finish());
+        ARROW_ASSIGN_OR_RAISE(auto vars_array , vars_builder.Finish());
+        group_aggr.means     = std::make_shared<ChunkedArray>(means_array);
+        group_aggr.variances = std::make_shared<ChunkedArray>(vars_array);
+
+        ARROW_RETURN_NOT_OK(pair_engine.AddGroup("group-" + std::to_string(group_ndx), group_aggr));
+    }
+
+    return Status::OK();
+}
+
+static Status
+RunAllPairs( PairwiseTStat     &pair_engine
+            ,int64_t            pair_limit
+            ,const std::string &output_fpath) {
+    shared_ptr<arrow::ipc::RecordBatchWriter> result_writer;
+    if (not output_fpath.empty()) {
+        ARROW_ASSIGN_OR_RAISE(auto output_file, arrow::io::FileOutputStream::Open(output_fpath));
+        ARROW_ASSIGN_OR_RAISE(
+             result_writer
+            ,arrow::ipc::MakeFileWriter(output_file, pair_engine.result_schema())
+        );
+    }
+
+    int64_t batch_count = 0;
+    auto    pairs_tstart = std::chrono::steady_clock::now();
+    ARROW_RETURN_NOT_OK(pair_engine.ComputeAllPairs(
+         pair_limit
+        ,[&](shared_ptr<RecordBatch> tstat_batch) {
+             ++batch_count;
+             if (result_writer == nullptr) { return Status::OK(); }
+
+             return result_writer->WriteRecordBatch(*tstat_batch);
+         }
+    ));
+    auto    pairs_tstop  = std::chrono::steady_clock::now();
+
+    if (result_writer != nullptr) { ARROW_RETURN_NOT_OK(result_writer->Close()); }
+
+    MillisDouble pairs_ttime { pairs_tstop - pairs_tstart };
+    std::cout << "Computed " << pair_engine.pair_count() << " pairs of "
+              << pair_engine.group_count()               << " groups in "
+              << batch_count                             << " batches: "
+              << pairs_ttime.count()                     << "ms"
+              << std::endl
+    ;
+
+    return Status::OK();
+}
+
+int main(int argc, char **argv) {
+    // ----------
+    // Process CLI options
+    std::string store_dirpath { "store" };
+    std::string domain_key, dataset_list, output_fpath;
+    int64_t     group_count   { 0       };
+    int64_t     gene_count    { 27118   };
+    int64_t     pair_limit    { 64      };
+    AggrOptions aggr_opts;
+
+    char parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    while (parsed_opt != (char) -1) {
+        switch (parsed_opt) {
+            case 's': { store_dirpath          = optarg;            break; }
+            case 'd': { domain_key             = optarg;            break; }
+            case 'g': { dataset_list           = optarg;            break; }
+            case 'k': { group_count            = std::stoll(optarg); break; }
+            case 'n': { gene_count             = std::stoll(optarg); break; }
+            case 'p': { pair_limit             = std::stoll(optarg); break; }
+            case 't': { aggr_opts.tile_rows    = std::stoll(optarg); break; }
+            case 'j': { aggr_opts.thread_count = std::stoi(optarg);  break; }
+            case 'o': { output_fpath           = optarg;            break; }
+
+            default: {
+                std::cerr << help_message << std::endl;
+                return 1;
+            }
+        }
+
+        parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    }
+
+    if (dataset_list.empty() == (group_count <= 0) or pair_limit <= 0 or aggr_opts.thread_count <= 0) {
+      std::cerr << "Error: expected either datasets or synthetic groups, and positive options." << std::endl
+                << help_message                                                                << std::endl
+      ;
+      return 1;
+    }
+
+    auto status_pool = arrow::SetCpuThreadPoolCapacity(aggr_opts.thread_count);
+    if (not status_pool.ok()) {
+      std::cerr << "Couldn't resize thread pool:"   << std::endl
+                << "\t" << status_pool.ToString() << std::endl
+      ;
+
+      return 1;
+    }
+
+    PairwiseTStat pair_engine { aggr_opts };
+    auto group_status = (
+          dataset_list.empty()
+        ? AddSyntheticGroups(pair_engine, group_count, gene_count)
+        : AddStoreGroups(pair_engine, store_dirpath, domain_key, dataset_list)
+    );
+
+    if (not group_status.ok()) {
+      std::cerr << "Couldn't prepare groups:"      << std::endl
+                << "\t" << group_status.ToString() << std::endl
+      ;
+
+      return 2;
+    }
+
+    if (not output_fpath.empty()) { output_fpath = std::filesystem::absolute(output_fpath).string(); }
+
+    auto pairs_status = RunAllPairs(pair_engine, pair_limit, output_fpath);
+    if (not pairs_status.ok()) {
+      std::cerr << "Couldn't compute t-statistics:" << std::endl
+                << "\t" << pairs_status.ToString()  << std::endl
+      ;
+
+      return 3;
+    }
+
+    return 0;
+}
@@ -0,0 +1,388 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#include <getopt.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include <arrow/util/thread_pool.h>
+
+#include "experiments.hpp"
+
+
+// ------------------------------
+// Variables
+
+static std::string help_message {
+    "Usage: <benchmark> [options] <path-to-resource-root>\n"
+    "\tAggregates each resource file in slices of every batch count, over every column\n"
+    "\tlimit, and reports (as CSV) statistics of the aggregation time over repetitions. Each\n"
+    "\tfile is loaded once, and each batch count's slices are built once, before timing.\n"
+    "\tColumns are those of resources/templates/header.csv, then the sweep's parameters and\n"
+    "\tthe min, median and p99 aggregation time (in ns). Other columns use the median run;\n"
+    "\tthe read stage is slicing the loaded table into batches. Peak pool memory is that of\n"
+    "\tthe measurement's own runs (warmup included); peak rss is that of the process.\n"
+    "Options:\n"
+    "\t-b, --batch-counts <N,...>: record batches per slice (default: 1,2,...,10)\n"
+    "\t-c, --col-limits <N,...>  : columns to aggregate; limits past the last column of a file\n"
+    "\t                            are skipped (default: 200,400,...,2000)\n"
+    "\t-f, --files <name,...>    : files under <resource-root>/resources\n"
+    "\t                            (default: the x300 and x565 resources)\n"
+    "\t-w, --warmup <N>          : untimed runs before each measurement (default: 1)\n"
+    "\t-r, --repeat <N>          : timed runs per measurement (default: 10)\n"
+    "\t-k, --kernel <name>       : vec, fused, tiled or arrow (default: fused); files of the\n"
+    "\t                            matrix layout have only the fused kernel\n"
+    "\t-t, --tile-rows <N>       : rows per tile for the tiled kernel (default: 4096)\n"
+    "\t-a, --alloc <name>        : memory pool for aggregation; default or recycling (default: default)\n"
+    "\t-j, --threads <N>         : row ranges of each slice aggregated in parallel (default: 1)"
+};
+
+static const char *option_template = "b:c:f:w:r:k:t:a:j:";
+
+static const struct option option_longnames[] = {
+     { "batch-counts", required_argument, nullptr, 'b' }
+    ,{ "col-limits"  , required_argument, nullptr, 'c' }
+    ,{ "files"       , required_argument, nullptr, 'f' }
+    ,{ "warmup"      , required_argument, nullptr, 'w' }
+    ,{ "repeat"      , required_argument, nullptr, 'r' }
+    ,{ "kernel"      , required_argument, nullptr, 'k' }
+    ,{ "tile-rows"   , required_argument, nullptr, 't' }
+    ,{ "alloc"       , required_argument, nullptr, 'a' }
+    ,{ "threads"     , required_argument, nullptr, 'j' }
+    ,{ nullptr       , 0                , nullptr,  0  }
+};
+
+static const char *default_resource_names = (
+    "E-GEOD-76312.48-2152.x300.feather,E-GEOD-76312.48-2152.x565.feather"
+);
+
+// appended to the columns of the header template
+static const char *sweep_header = (
+    "\"resource\",\"batch count\",\"kernel\",\"alloc\",\"tile rows\",\"threads\",\"warmup\","
+    "\"repetitions\",\"min aggr ns\",\"median aggr ns\",\"p99 aggr ns\",\"alloc ns per run\""
+);
+
+
+// ------------------------------
+// Functions
+
+using std::chrono::nanoseconds;
+
+static Result<std::vector<int64_t>>
+SplitCounts(const std::string &list_str) {
+    ARROW_ASSIGN_OR_RAISE(auto count_strs, SplitList(list_str));
+
+    std::vector<int64_t> counts;
+    for (const auto &count_str : count_strs) {
+        char    *count_end = nullptr;
+        int64_t  count_val = std::strtoll(count_str.c_str(), &count_end, 10);
+        if (*count_end != '\0' or count_val <= 0) {
+            return Status::Invalid("Expected a positive count; got '", count_str, "'");
+        }
+
+        counts.push_back(count_val);
+    }
+
+    return counts;
+}
+
+// One timed run: aggregation time of every slice, in order
+struct SweepRun {
+    std::vector<nanoseconds> slice_ttimes;
+    nanoseconds              total_ttime { 0 };
+};
+
+static Result<SweepRun>
+AggrSlices( const std::vector<shared_ptr<Table>> &table_slices
+           ,int64_t                               row_count
+           ,int64_t                               col_limit
+           ,AggrOptions                           aggr_opts) {
+    SweepRun  sweep_run;
+    SliceAggr slice_aggr { aggr_opts, row_count };
+
+    for (const auto &table_slice : table_slices) {
+        auto slice_ttime = slice_aggr.AggrSlice(table_slice, 1, col_limit);
+
+        sweep_run.slice_ttimes.push_back(slice_ttime);
+        sweep_run.total_ttime += slice_ttime;
+    }
+
+    ARROW_RETURN_NOT_OK(slice_aggr.status());
+    return sweep_run;
+}
+
+// Nearest-rank percentile of runs sorted by total time
+static const SweepRun &
+RunAtPercentile(const std::vector<SweepRun> &sorted_runs, double percentile) {
+    size_t rank = static_cast<size_t>(std::ceil(percentile * sorted_runs.size()));
+    return sorted_runs[std::clamp<size_t>(rank, 1, sorted_runs.size()) - 1];
+}
+
+struct SweepOptions {
+    std::vector<int64_t> batch_counts;
+    std::vector<int64_t> col_limits;
+    int                  warmup_count { 1  };
+    int                  run_count    { 10 };
+    PoolKind             pool_kind    { PoolKind::Default };
+    AggrOptions          aggr_opts;
+};
+
+static Status
+BenchResource(const std::filesystem::path &resource_path, const SweepOptions &sweep_opts) {
+    auto load_tstart = std::chrono::steady_clock::now();
+    ARROW_ASSIGN_OR_RAISE(auto src_table, ReadIPCFile(UriForPath(resource_path)));
+    nanoseconds load_ttime { std::chrono::steady_clock::now() - load_tstart };
+    ARROW_RETURN_NOT_OK(CheckLayoutKernel(*src_table->schema(), sweep_opts.aggr_opts.kernel));
+
+    int64_t row_count = src_table->num_rows();
+    int64_t col_count = AggrColumnCount(src_table) - 1;
+
+    for (int64_t batch_count : sweep_opts.batch_counts) {
+        // >> slice the table once per batch count, as `experiment-arrowcompute` would; this
+        //    is the read stage of every run
+        std::vector<shared_ptr<Table>> table_slices;
+        arrow::TableBatchReader        table_batcher { *src_table };
+
+        auto read_tstart  = std::chrono::steady_clock::now();
+        auto slice_result = ReadBatchesFromTable(table_batcher, batch_count);
+        while (slice_result.ok()) {
+            table_slices.push_back(*slice_result);
+            slice_result = ReadBatchesFromTable(table_batcher, batch_count);
+        }
+        nanoseconds read_ttime { std::chrono::steady_clock::now() - read_tstart };
+
+        // only the end of the table stops the loop cleanly; don't time a truncated slice set
+        if (not IsEndOfBatches(slice_result.status())) { return slice_result.status(); }
+        if (table_slices.empty())                       { return slice_result.status(); }
+
+        int64_t slice_rows = table_slices[0]->num_rows();
+        for (int64_t col_limit : sweep_opts.col_limits) {
+            if (col_limit > col_count) { continue; }
+
+            // a pool per measurement, so "peak pool memory" covers only its own runs
+            // (and a timer, so "alloc ns per run" covers only the allocations of its runs)
+            arrow::ProxyMemoryPool measure_pool  { sweep_opts.aggr_opts.memory_pool() };
+            TimedMemoryPool        measure_timer { &measure_pool };
+            ExecContext            measure_ctx   { &measure_timer, sweep_opts.aggr_opts.executor() };
+            AggrOptions            measure_opts  { sweep_opts.aggr_opts };
+            measure_opts.exec_ctx = &measure_ctx;
+
+            for (int run_ndx = 0; run_ndx < sweep_opts.warmup_count; ++run_ndx) {
+                ARROW_RETURN_NOT_OK(
+                    AggrSlices(table_slices, row_count, col_limit, measure_opts).status()
+                );
+            }
+
+            auto                  warmup_alloc = measure_timer.Times();
+            std::vector<SweepRun> sweep_runs;
+            for (int run_ndx = 0; run_ndx < sweep_opts.run_count; ++run_ndx) {
+                ARROW_ASSIGN_OR_RAISE(
+                     auto sweep_run
+                    ,AggrSlices(table_slices, row_count, col_limit, measure_opts)
+                );
+
+                sweep_runs.push_back(std::move(sweep_run));
+            }
+
+            std::sort(
+                 sweep_runs.begin(), sweep_runs.end()
+                ,[](const SweepRun &left, const SweepRun &right) {
+                     return left.total_ttime < right.total_ttime;
+                 }
+            );
+
+            int64_t run_alloc_ns = (
+                measure_timer.Times().call_time - warmup_alloc.call_time
+            ).count();
+
+            const auto &min_run    = sweep_runs.front();
+            const auto &median_run = RunAtPercentile(sweep_runs, 0.50);
+            const auto &p99_run    = RunAtPercentile(sweep_runs, 0.99);
+
+            // stages are serial, as in `experiment-arrowcompute` without a queue depth: each
+            // is idle while the other one works
+            StageTime read_stage { read_ttime, median_run.total_ttime };
+            StageTime aggr_stage { median_run.total_ttime, read_ttime };
+
+            double median_ms = ToMillis(median_run.total_ttime);
+            std::cout <<         "\"" << slice_rows << ":" << row_count % slice_rows << "\""
+                      << "," <<  col_limit
+                      << "," << "\"" << median_ms                                         << "ms"  << "\""
+                      << "," << "\"" << median_ms / table_slices.size()                   << "ms"  << "\""
+                      << "," << "\"" << ToMillis(median_run.slice_ttimes[0])              << "ms"  << "\""
+                      << "," << "\"" << measure_pool.max_memory() / (1 << 20)             << "MiB" << "\""
+                      << "," << "\"" << PeakResidentBytes() / (1 << 20)                   << "MiB" << "\""
+                      << "," << "\"" << ToMillis(load_ttime)                              << "ms"  << "\""
+                      << "," << "\"" << ToMillis(read_stage.busy)                         << "ms"  << "\""
+                      << "," << "\"" << ToMillis(read_stage.idle)                         << "ms"  << "\""
+                      << "," << "\"" << ToMillis(aggr_stage.busy)                         << "ms"  << "\""
+                      << "," << "\"" << ToMillis(aggr_stage.idle)                         << "ms"  << "\""
+                      << "," << "\"" << resource_path.filename().string()                 << "\""
+                      << "," <<  batch_count
+                      << "," << "\"" << AggrKernelName(sweep_opts.aggr_opts.kernel)       << "\""
+                      << "," << "\"" << PoolKindName(sweep_opts.pool_kind)                << "\""
+                      << "," <<  sweep_opts.aggr_opts.tile_rows
+                      << "," <<  sweep_opts.aggr_opts.thread_count
+                      << "," <<  sweep_opts.warmup_count
+                      << "," <<  sweep_opts.run_count
+                      << "," <<  min_run.total_ttime.count()
+                      << "," <<  median_run.total_ttime.count()
+                      << "," <<  p99_run.total_ttime.count()
+                      << "," <<  run_alloc_ns / sweep_opts.run_count
+                      << std::endl
+            ;
+        }
+    }
+
+    return Status::OK();
+}
+
+int main(int argc, char **argv) {
+    // ----------
+    // Process CLI options, then positional args
+    SweepOptions sweep_opts;
+    std::string  batch_list     { "1,2,3,4,5,6,7,8,9,10"                         };
+    std::string  col_list       { "200,400,600,800,1000,1200,1400,1600,1800,2000" };
+    std::string  resource_list  { default_resource_names                          };
+
+    char parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    while (parsed_opt != (char) -1) {
+        switch (parsed_opt) {
+            case 'b': { batch_list                        = optarg;             break; }
+            case 'c': { col_list                          = optarg;             break; }
+            case 'f': { resource_list                     = optarg;             break; }
+            case 'w': { sweep_opts.warmup_count           = std::stoi(optarg);  break; }
+            case 'r': { sweep_opts.run_count              = std::stoi(optarg);  break; }
+            case 't': { sweep_opts.aggr_opts.tile_rows    = std::stoll(optarg); break; }
+            case 'j': { sweep_opts.aggr_opts.thread_count = std::stoi(optarg);  break; }
+
+            case 'k': {
+                auto kernel_result = AggrKernelFromName(optarg);
+                if (not kernel_result.ok()) {
+                    std::cerr << "Error: " << kernel_result.status().message() << std::endl
+                              << help_message                                  << std::endl
+                    ;
+                    return 1;
+                }
+
+                sweep_opts.aggr_opts.kernel = *kernel_result;
+                break;
+            }
+
+            case 'a': {
+                auto pool_result = PoolKindFromName(optarg);
+                if (not pool_result.ok()) {
+                    std::cerr << "Error: " << pool_result.status().message() << std::endl
+                              << help_message                                << std::endl
+                    ;
+                    return 1;
+                }
+
+                sweep_opts.pool_kind = *pool_result;
+                break;
+            }
+
+            default: {
+                std::cerr << help_message << std::endl;
+                return 1;
+            }
+        }
+
+        parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    }
+
+    auto batch_counts   = SplitCounts(batch_list);
+    auto col_limits     = SplitCounts(col_list);
+    auto resource_names = SplitList(resource_list);
+
+    bool is_valid = (
+            argc - optind == 1
+        and batch_counts.ok() and col_limits.ok() and resource_names.ok()
+        and sweep_opts.warmup_count >= 0 and sweep_opts.run_count > 0
+        and sweep_opts.aggr_opts.tile_rows > 0 and sweep_opts.aggr_opts.thread_count > 0
+    );
+
+    if (not is_valid) {
+      std::cerr << "Error: expected 1 argument, lists of positive counts and positive option values."
+                << std::endl
+                << help_message
+                << std::endl
+      ;
+      return 1;
+    }
+
+    sweep_opts.batch_counts = *batch_counts;
+    sweep_opts.col_limits   = *col_limits;
+
+    // recycled buffers stay cached across runs, as they would across slices of 1 run
+    unique_ptr<RecyclingMemoryPool> recycling_pool;
+    if (sweep_opts.pool_kind == PoolKind::Recycling) {
+        recycling_pool = std::make_unique<RecyclingMemoryPool>();
+    }
+
+    // each slice's rows are split across `-j` threads (see `SliceAggr`), on a pool of that
+    // size, so the "threads" column is the parallelism that was measured
+    auto aggr_pool_result = arrow::internal::ThreadPool::Make(sweep_opts.aggr_opts.thread_count);
+    if (not aggr_pool_result.ok()) {
+      std::cerr << "Couldn't create thread pool:"                << std::endl
+                << "\t" << aggr_pool_result.status().ToString() << std::endl
+      ;
+      return 1;
+    }
+
+    auto aggr_threads = *aggr_pool_result;
+
+    ExecContext aggr_ctx {
+         recycling_pool ? recycling_pool.get() : arrow::default_memory_pool()
+        ,aggr_threads.get()
+    };
+    sweep_opts.aggr_opts.exec_ctx = &aggr_ctx;
+
+    // ----------
+    // The header template's columns, then the sweep's
+    auto          resource_root = std::filesystem::absolute(argv[optind]);
+    std::ifstream header_file   { resource_root / "resources" / "templates" / "header.csv" };
+    std::string   header_line;
+
+    if (not std::getline(header_file, header_line)) {
+      std::cerr << "Couldn't read [resources/templates/header.csv] under ["
+                << resource_root.string() << "]"
+                << std::endl
+      ;
+      return 1;
+    }
+
+    std::cout << header_line << "," << sweep_header << std::endl;
+
+    for (const auto &resource_name : *resource_names) {
+        auto bench_status = BenchResource(resource_root / "resources" / resource_name, sweep_opts);
+
+        if (not bench_status.ok()) {
+          std::cerr << "Failed to benchmark [" << resource_name << "]:" << std::endl
+                    << "\t" << bench_status.ToString()                   << std::endl
+          ;
+
+          return 2;
+        }
+    }
+
+    return 0;
+}
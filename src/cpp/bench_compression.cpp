@@ -0,0 +1,266 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#include <getopt.h>
+#include <filesystem>
+#include <limits>
+
+#include <arrow/util/compression.h>
+#include <arrow/util/thread_pool.h>
+
+#include "experiments.hpp"
+
+
+// ------------------------------
+// Variables
+
+static std::string help_message {
+    "Usage: <benchmark> [options] <path-to-resource-root>\n"
+    "\tRewrites each resource file uncompressed, with LZ4 and with ZSTD, then reports (as CSV)\n"
+    "\tthe file size, the time to read and decode it, and the time to read and aggregate it\n"
+    "\twhole ('table') and streamed ('stream', decode overlapped with aggregation).\n"
+    "Options:\n"
+    "\t-d, --decode-threads <N>: threads that decompress each record batch (default: 1)\n"
+    "\t-q, --qdepth <N>        : slices read ahead of the aggregation when streaming (default: 2)\n"
+    "\t-r, --repeat <N>        : runs per measurement; the fastest is reported (default: 3)"
+};
+
+static const char *option_template = "d:q:r:";
+
+static const struct option option_longnames[] = {
+     { "decode-threads", required_argument, nullptr, 'd' }
+    ,{ "qdepth"        , required_argument, nullptr, 'q' }
+    ,{ "repeat"        , required_argument, nullptr, 'r' }
+    ,{ nullptr         , 0                , nullptr,  0  }
+};
+
+static const std::vector<std::string> resource_names {
+     "E-GEOD-76312.48-2152.x300.feather"
+    ,"E-GEOD-76312.48-2152.x565.feather"
+};
+
+static const std::vector<arrow::Compression::type> codec_types {
+     arrow::Compression::UNCOMPRESSED
+    ,arrow::Compression::LZ4_FRAME
+    ,arrow::Compression::ZSTD
+};
+
+
+// ------------------------------
+// Classes
+
+// Removes a file when it goes out of scope, however the scope is left
+class RemoveOnExit {
+  public:
+    explicit RemoveOnExit(std::filesystem::path file_path) : file_path(std::move(file_path)) {}
+
+    ~RemoveOnExit() {
+        std::error_code fs_err;
+        std::filesystem::remove(file_path, fs_err);
+    }
+
+    RemoveOnExit(const RemoveOnExit &)            = delete;
+    RemoveOnExit &operator=(const RemoveOnExit &) = delete;
+
+  private:
+    std::filesystem::path file_path;
+};
+
+
+// ------------------------------
+// Functions
+
+// Fastest of `run_count` runs of `run_fn`, which returns a Status
+template<typename RunFnType>
+static Result<MillisDouble>
+FastestRun(int run_count, RunFnType &&run_fn) {
+    MillisDouble fastest_ttime { std::numeric_limits<double>::max() };
+
+    for (int run_ndx = 0; run_ndx < run_count; ++run_ndx) {
+        auto run_tstart = std::chrono::steady_clock::now();
+        ARROW_RETURN_NOT_OK(run_fn());
+        auto run_tstop  = std::chrono::steady_clock::now();
+
+        fastest_ttime = std::min(fastest_ttime, MillisDouble { run_tstop - run_tstart });
+    }
+
+    return fastest_ttime;
+}
+
+// Read and aggregate the whole table
+static Status
+ReadAndAggrTable(const std::string &file_uri) {
+    ARROW_ASSIGN_OR_RAISE(auto data_table, ReadIPCFile(file_uri));
+
+    MeanAggr table_aggr;
+    return table_aggr.Accumulate(data_table);
+}
+
+// Stream record batches and aggregate each one as it is decoded
+static Status
+StreamAndAggrSlices(const std::string &file_uri, int qdepth) {
+    int64_t row_count { 0 };
+    ARROW_ASSIGN_OR_RAISE(auto batch_stream, StreamIPCFile(file_uri, &row_count));
+
+    SliceAggr       slice_aggr       { AggrOptions {}, row_count };
+    SlicePrefetcher slice_prefetcher { *batch_stream, 1, static_cast<size_t>(qdepth) };
+
+    auto slice_result = slice_prefetcher.Next();
+    while (slice_result.ok()) {
+        slice_aggr.AggrSlice(*slice_result, 1, 0);
+        slice_result = slice_prefetcher.Next();
+    }
+
+    // only the end of the stream stops the loop cleanly; report a decode or IO failure
+    if (not IsEndOfBatches(slice_result.status())) { return slice_result.status(); }
+
+    ARROW_RETURN_NOT_OK(slice_aggr.status());
+    if (slice_aggr.rows_aggregated() != row_count) {
+        return Status::Invalid("Aggregated ", slice_aggr.rows_aggregated(), " of ", row_count, " rows");
+    }
+
+    return Status::OK();
+}
+
+static Status
+BenchResource( const std::filesystem::path &resource_path
+              ,const std::filesystem::path &bench_dirpath
+              ,int                          run_count
+              ,int                          qdepth) {
+    std::string src_uri { UriForPath(resource_path) };
+
+    ARROW_ASSIGN_OR_RAISE(auto src_table, ReadIPCFile(src_uri));
+
+    for (auto codec_type : codec_types) {
+        if (not arrow::util::Codec::IsAvailable(codec_type)) {
+            std::cerr << "Skipping unavailable codec ["
+                      << arrow::util::Codec::GetCodecAsString(codec_type)
+                      << "]" << std::endl
+            ;
+
+            continue;
+        }
+
+        // >> write this encoding of the resource, with the source's record batch size
+        auto write_props        = WriteProperties::Defaults();
+        write_props.compression = codec_type;
+        write_props.chunksize   = SourceChunkRows(*src_table);
+
+        auto bench_fpath = bench_dirpath / (
+            arrow::util::Codec::GetCodecAsString(codec_type) + "." + resource_path.filename().string()
+        );
+
+        // the encoded copy is removed even if writing or a measurement fails
+        RemoveOnExit bench_file { bench_fpath };
+        std::string  bench_uri  { UriForPath(bench_fpath) };
+        ARROW_RETURN_NOT_OK(WriteIPCFile(bench_uri, src_table, write_props));
+
+        // >> decode (read) time, and end-to-end time for whole-table and streamed aggregation
+        ARROW_ASSIGN_OR_RAISE(
+             auto decode_ttime
+            ,FastestRun(run_count, [&]() { return ReadIPCFile(bench_uri).status(); })
+        );
+
+        ARROW_ASSIGN_OR_RAISE(
+             auto table_ttime
+            ,FastestRun(run_count, [&]() { return ReadAndAggrTable(bench_uri); })
+        );
+
+        ARROW_ASSIGN_OR_RAISE(
+             auto stream_ttime
+            ,FastestRun(run_count, [&]() { return StreamAndAggrSlices(bench_uri, qdepth); })
+        );
+
+        std::cout <<         resource_path.filename().string()
+                  << "," <<  arrow::util::Codec::GetCodecAsString(codec_type)
+                  << "," <<  std::filesystem::file_size(bench_fpath)
+                  << "," << "\"" << decode_ttime.count() << "ms" << "\""
+                  << "," << "\"" << table_ttime.count()  << "ms" << "\""
+                  << "," << "\"" << stream_ttime.count() << "ms" << "\""
+                  << std::endl
+        ;
+    }
+
+    return Status::OK();
+}
+
+int main(int argc, char **argv) {
+    // ----------
+    // Process CLI options, then positional args
+    int decode_threads { 1 };
+    int qdepth         { 2 };
+    int run_count      { 3 };
+
+    char parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    while (parsed_opt != (char) -1) {
+        switch (parsed_opt) {
+            case 'd': { decode_threads = std::stoi(optarg); break; }
+            case 'q': { qdepth         = std::stoi(optarg); break; }
+            case 'r': { run_count      = std::stoi(optarg); break; }
+
+            default: {
+                std::cerr << help_message << std::endl;
+                return 1;
+            }
+        }
+
+        parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    }
+
+    if (argc - optind != 1 or decode_threads <= 0 or qdepth <= 0 or run_count <= 0) {
+      std::cerr << "Error: expected 1 argument and positive option values." << std::endl
+                << help_message                                           << std::endl
+      ;
+      return 1;
+    }
+
+    auto status_pool = arrow::SetCpuThreadPoolCapacity(decode_threads);
+    if (not status_pool.ok()) {
+      std::cerr << "Couldn't resize thread pool:"   << std::endl
+                << "\t" << status_pool.ToString() << std::endl
+      ;
+
+      return 1;
+    }
+
+    auto resource_dirpath = std::filesystem::absolute(argv[optind]) / "resources";
+    auto bench_dirpath    = std::filesystem::temp_directory_path();
+
+    std::cout << "\"resource\",\"codec\",\"file bytes\",\"decode time\","
+                 "\"table aggr time\",\"stream aggr time\""
+              << std::endl
+    ;
+
+    for (const auto &resource_name : resource_names) {
+        auto bench_status = BenchResource(
+            resource_dirpath / resource_name, bench_dirpath, run_count, qdepth
+        );
+
+        if (not bench_status.ok()) {
+          std::cerr << "Failed to benchmark [" << resource_name << "]:" << std::endl
+                    << "\t" << bench_status.ToString()                   << std::endl
+          ;
+
+          return 2;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#include "experiments.hpp"
+
+
+// ------------------------------
+// Variables
+
+static std::string help_message {
+    "Usage: <converter> <path-to-wide-feather> <path-to-matrix-feather>\n"
+    "\tRewrites a wide feather file (key column, then 1 float64 column per sample) in the\n"
+    "\tmatrix layout (key column, then 1 fixed_size_list<double> column of samples)."
+};
+
+
+// ------------------------------
+// Functions
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+      std::cerr << "Error: expected 2 arguments." << std::endl
+                << help_message                   << std::endl
+      ;
+      return 1;
+    }
+
+    auto rewrite_result = RewriteIPCFile(
+         UriForPath(argv[1])
+        ,UriForPath(argv[2])
+        ,[](shared_ptr<Table> wide_table) { return ToMatrixLayout(wide_table); }
+    );
+    if (not rewrite_result.ok()) {
+      std::cerr << "Couldn't convert file:"                   << std::endl
+                << "\t" << rewrite_result.status().ToString() << std::endl
+      ;
+
+      return 1;
+    }
+
+    auto matrix_table = *rewrite_result;
+    std::cout << "Converted [" << matrix_table->num_rows()          << " rows, "
+                               << AggrColumnCount(matrix_table) - 1 << " samples]"
+              << std::endl
+    ;
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#include "experiments.hpp"
+
+
+// ------------------------------
+// Variables
+
+static std::string help_message {
+    "Usage: <encoder> <path-to-gene-annotations> <path-to-feather> <path-to-encoded-feather>\n"
+    "\tRewrites the key column (gene IDs) of a feather file as int32 gene codes: the row of\n"
+    "\teach gene in the annotation table (its key column). Rows whose gene is not annotated\n"
+    "\tare dropped. Every other column is kept as is."
+};
+
+
+// ------------------------------
+// Functions
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+      std::cerr << "Error: expected 3 arguments." << std::endl
+                << help_message                   << std::endl
+      ;
+      return 1;
+    }
+
+    auto annotation_result = ReadIPCFile(UriForPath(argv[1]));
+    if (not annotation_result.ok()) {
+      std::cerr << "Couldn't read gene annotations:"             << std::endl
+                << "\t" << annotation_result.status().ToString() << std::endl
+      ;
+
+      return 1;
+    }
+
+    auto dict_result = GeneDictionary::FromTable(*annotation_result);
+    if (not dict_result.ok()) {
+      std::cerr << "Couldn't build gene dictionary:"       << std::endl
+                << "\t" << dict_result.status().ToString() << std::endl
+      ;
+
+      return 1;
+    }
+
+    int64_t dropped_count  = 0;
+    auto    rewrite_result = RewriteIPCFile(
+         UriForPath(argv[2])
+        ,UriForPath(argv[3])
+        ,[&](shared_ptr<Table> src_table) {
+             return dict_result->EncodeTable(src_table, &dropped_count);
+         }
+    );
+    if (not rewrite_result.ok()) {
+      std::cerr << "Couldn't encode file:"                    << std::endl
+                << "\t" << rewrite_result.status().ToString() << std::endl
+      ;
+
+      return 2;
+    }
+
+    std::cout << "Encoded [" << (*rewrite_result)->num_rows() << " rows, "
+                             << dropped_count                 << " dropped] against ["
+                             << dict_result->size()           << " genes]"
+              << std::endl
+    ;
+
+    return 0;
+}
@@ -18,6 +18,13 @@
 
 // ------------------------------
 // Dependencies
+#include <getopt.h>
+#include <fstream>
+#include <optional>
+#include <sstream>
+
+#include <arrow/util/thread_pool.h>
+
 #include "experiments.hpp"
 
 
@@ -25,116 +32,515 @@
 // Variables
 
 static std::string help_message {
-    "experiment_one <absolute path to current dir> <'table' | 'vector'>"
+    "Usage: <experiment> [options] <path-to-resource-root> <'table' | 'vector' | 'stream'> [batch-count] [col-count]\n"
+    "Options:\n"
+    "\t-b, --batches <start>[:<count>]                   : read only these record batches (default: all)\n"
+    "\t-i, --io <'read' | 'mmap' | 'prefetch'>           : how the input file is loaded (default: read)\n"
+    "\t-d, --decode-threads <N>                          : threads that decompress compressed input, apart from\n"
+    "\t                                                    the threads that accumulate (default: 1)\n"
+    "\t-f, --float32                                     : read float32 samples of the input (see convert-float32)\n"
+    "\t-m, --matrix                                      : read the matrix layout of the input (see convert-matrix);\n"
+    "\t                                                    it has only the fused kernel\n"
+    "\t-k, --kernel <'vec' | 'fused' | 'tiled' | 'arrow'>: kernel used to accumulate columns (default: fused)\n"
+    "\t-t, --tile-rows <rows>                            : rows per tile for the 'tiled' kernel (default: 4096)\n"
+    "\t-a, --alloc <'default' | 'recycling'>             : memory pool for aggregation state and vec intermediates;\n"
+    "\t                                                    'recycling' reuses freed buffers (default: default)\n"
+    "\t-j, --threads <N>                                 : threads that accumulate row ranges of the table, or of\n"
+    "\t                                                    each slice (default: 1)\n"
+    "\t-p, --partitions <K>                              : accumulate K column ranges in parallel, then merge\n"
+    "\t-q, --qdepth <N>                                  : read up to N slices ahead of the aggregation (default: 0)\n"
+    "\t-s, --scaling                                     : time the whole table at 1, 2, 4, ..., N threads (to stderr)\n"
+    "\t-v, --verify                                      : verify results against a reference kernel (to stderr)\n"
+    "\t-o, --profile <path | '-'>                        : append a JSON record of the run's phases (time, memory\n"
+    "\t                                                    pool and hardware counters) to a file, or to stderr"
+};
+
+static const char *option_template = "b:i:d:fmk:t:a:j:p:q:svo:";
+
+static const struct option option_longnames[] = {
+     { "batches"       , required_argument, nullptr, 'b' }
+    ,{ "io"            , required_argument, nullptr, 'i' }
+    ,{ "decode-threads", required_argument, nullptr, 'd' }
+    ,{ "float32"       , no_argument      , nullptr, 'f' }
+    ,{ "matrix"        , no_argument      , nullptr, 'm' }
+    ,{ "kernel"        , required_argument, nullptr, 'k' }
+    ,{ "tile-rows"     , required_argument, nullptr, 't' }
+    ,{ "alloc"         , required_argument, nullptr, 'a' }
+    ,{ "threads"       , required_argument, nullptr, 'j' }
+    ,{ "partitions"    , required_argument, nullptr, 'p' }
+    ,{ "qdepth"        , required_argument, nullptr, 'q' }
+    ,{ "scaling"       , no_argument      , nullptr, 's' }
+    ,{ "verify"        , no_argument      , nullptr, 'v' }
+    ,{ "profile"       , required_argument, nullptr, 'o' }
+    ,{ nullptr         , 0                , nullptr,  0  }
 };
 
 
 // ------------------------------
 // Functions
 
+// Append the run's profile, as 1 line of JSON, to `profile_fpath` ("-" is stderr)
+static bool
+WriteProfile(const RunProfile &run_profile, const std::string &profile_fpath) {
+    if (profile_fpath == "-") {
+        std::cerr << run_profile.ToJson() << std::endl;
+        return true;
+    }
+
+    std::ofstream profile_file { profile_fpath, std::ios::app };
+    profile_file << run_profile.ToJson() << std::endl;
+
+    return profile_file.good();
+}
+
+// A time in milliseconds (e.g. "1.25ms"), or "" when there is none to report
+static std::string
+MillisText(std::optional<std::chrono::nanoseconds> ttime) {
+    if (not ttime.has_value()) { return ""; }
+
+    std::ostringstream ttime_text;
+    ttime_text << ToMillis(*ttime) << "ms";
+
+    return ttime_text.str();
+}
+
 int main(int argc, char **argv) {
     // ----------
-    // Process CLI args for convenience
-    if (argc < 3) {
-      // we need this to make it easier to run on various systems
-      std::cerr << "Error: too few arguments."
-                << std::endl
-                << "Usage: <experiment> <path-to-resource-root> <aggregation scope> [batch-count] [col-count]"
+    // Process CLI options, then positional args
+    AggrOptions    aggr_opts;
+    IOStrategy     io_strategy    { IOStrategy::Read };
+    PoolKind       pool_kind      { PoolKind::Default };
+    ReadProjection read_proj;
+    int            qdepth         { 0     };
+    int            decode_threads { 1     };
+    bool           use_matrix     { false };
+    bool           use_float32    { false };
+    bool           should_verify  { false };
+    bool           should_scale   { false };
+    std::string    profile_fpath;
+
+    char parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    while (parsed_opt != (char) -1) {
+        switch (parsed_opt) {
+            case 'b': {
+                std::string batch_range { optarg };
+                size_t      range_sep   = batch_range.find(':');
+
+                read_proj.batch_startndx = std::stoi(batch_range.substr(0, range_sep));
+                if (range_sep != std::string::npos) {
+                    read_proj.batch_limit = std::stoi(batch_range.substr(range_sep + 1));
+                }
+
+                if (read_proj.batch_startndx < 0 or read_proj.batch_limit < 0) {
+                    std::cerr << "Error: batch range must be non-negative" << std::endl;
+                    return 1;
+                }
+
+                break;
+            }
+
+            case 'i': {
+                auto io_result = IOStrategyFromName(optarg);
+                if (not io_result.ok()) {
+                    std::cerr << "Error: " << io_result.status().message() << std::endl
+                              << help_message                              << std::endl
+                    ;
+                    return 1;
+                }
+
+                io_strategy = *io_result;
+                break;
+            }
+
+            case 'd': {
+                decode_threads = std::stoi(optarg);
+                if (decode_threads <= 0) {
+                    std::cerr << "Error: decode thread count must be positive" << std::endl;
+                    return 1;
+                }
+
+                break;
+            }
+
+            case 'f': {
+                use_float32 = true;
+                break;
+            }
+
+            case 'm': {
+                use_matrix = true;
+                break;
+            }
+
+            case 'k': {
+                auto kernel_result = AggrKernelFromName(optarg);
+                if (not kernel_result.ok()) {
+                    std::cerr << "Error: " << kernel_result.status().message() << std::endl
+                              << help_message                                  << std::endl
+                    ;
+                    return 1;
+                }
+
+                aggr_opts.kernel = *kernel_result;
+                break;
+            }
+
+            case 't': {
+                aggr_opts.tile_rows = std::stoll(optarg);
+                if (aggr_opts.tile_rows <= 0) {
+                    std::cerr << "Error: tile rows must be positive" << std::endl;
+                    return 1;
+                }
+
+                break;
+            }
+
+            case 'a': {
+                auto pool_result = PoolKindFromName(optarg);
+                if (not pool_result.ok()) {
+                    std::cerr << "Error: " << pool_result.status().message() << std::endl
+                              << help_message                                << std::endl
+                    ;
+                    return 1;
+                }
+
+                pool_kind = *pool_result;
+                break;
+            }
+
+            case 'j': {
+                aggr_opts.thread_count = std::stoi(optarg);
+                if (aggr_opts.thread_count <= 0) {
+                    std::cerr << "Error: thread count must be positive" << std::endl;
+                    return 1;
+                }
+
+                break;
+            }
+
+            case 'p': {
+                aggr_opts.col_partitions = std::stoi(optarg);
+                if (aggr_opts.col_partitions <= 0) {
+                    std::cerr << "Error: partition count must be positive" << std::endl;
+                    return 1;
+                }
+
+                break;
+            }
+
+            case 'q': {
+                qdepth = std::stoi(optarg);
+                if (qdepth < 0) {
+                    std::cerr << "Error: queue depth must be non-negative" << std::endl;
+                    return 1;
+                }
+
+                break;
+            }
+
+            case 's': {
+                should_scale = true;
+                break;
+            }
+
+            case 'v': {
+                should_verify = true;
+                break;
+            }
+
+            case 'o': {
+                profile_fpath = optarg;
+                break;
+            }
+
+            default: {
+                std::cerr << help_message << std::endl;
+                return 1;
+            }
+        }
+
+        parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    }
+
+    // the matrix layout has only the fused kernel (see `CheckLayoutKernel`)
+    if (use_matrix and aggr_opts.kernel != AggrKernel::Fused) {
+      std::cerr << "Error: -m/--matrix aggregates with the fused kernel only; got '"
+                << AggrKernelName(aggr_opts.kernel) << "'"
                 << std::endl
       ;
       return 1;
     }
 
-    else if (argc > 5) {
-      std::cerr << "Error: too many arguments."
-                << std::endl
-                << "Usage: <experiment> <path-to-resource-root> <aggregation scope> [batch-count] [col-count]"
-                << std::endl
+    int arg_count = argc - optind;
+    if (arg_count < 2) {
+      // we need this to make it easier to run on various systems
+      std::cerr << "Error: too few arguments." << std::endl
+                << help_message                << std::endl
+      ;
+      return 1;
+    }
+
+    else if (arg_count > 4) {
+      std::cerr << "Error: too many arguments." << std::endl
+                << help_message                 << std::endl
       ;
       return 2;
     }
 
-    std::string work_dirpath     { argv[1] };
-    std::string should_aggrtable { argv[2] };
-    size_t      batch_count      { 1       };
-    int64_t     col_limit        { 0       };
+    std::string work_dirpath     { argv[optind]     };
+    std::string should_aggrtable { argv[optind + 1] };
+    size_t      batch_count      { 1                };
+    int64_t     col_limit        { 0                };
 
+    std::string wide_fpath {
+        UriForPath(work_dirpath + "/resources/E-GEOD-76312.48-2152.x565.feather")
+      // UriForPath(work_dirpath + "/resources/E-GEOD-76312.48-2152.x300.feather")
+    };
+
+    // the matrix layout of the same data is written by `convert-matrix`, and float32
+    // samples (of either layout) by `convert-float32`
     std::string test_fpath {
-        "file://"
-      + work_dirpath
-      + "/resources/E-GEOD-76312.48-2152.x565.feather"
-      // + "/resources/E-GEOD-76312.48-2152.x300.feather"
+        wide_fpath.substr(0, wide_fpath.size() - 8)
+      + (use_matrix  ? ".matrix" : "")
+      + (use_float32 ? ".f32"    : "")
+      + ".feather"
     };
-    bool aggr_table { should_aggrtable == "table" };
+    bool aggr_table  { should_aggrtable == "table"  };
+    bool aggr_stream { should_aggrtable == "stream" };
 
-    if (argc >= 4) { batch_count  = std::stoull(argv[3]); }
-    if (argc == 5) { col_limit    = std::stoll(argv[4]);  }
+    if (arg_count >= 3) { batch_count = std::stoull(argv[optind + 2]); }
+    if (arg_count == 4) { col_limit   = std::stoll(argv[optind + 3]);  }
+
+    // only read the key column, the columns to aggregate, and the selected batches
+    read_proj.col_indices = ProjectKeyAndColumns(col_limit).col_indices;
 
     #if DEBUG != 0
       std::cout << "Using directory  [" << work_dirpath << "]" << std::endl;
       std::cout << "Aggregating over ["
-                << (aggr_table ? "table" : "vector")
+                << (aggr_table ? "table" : (aggr_stream ? "stream" : "vector"))
                 << "]" << std::endl
       ;
 
+      std::cout << "Input file            [" << test_fpath << "]" << std::endl;
+      std::cout << "Input IO strategy     [" << IOStrategyName(io_strategy) << "]" << std::endl;
+      std::cout << "Accumulate kernel     [" << AggrKernelName(aggr_opts.kernel) << "]" << std::endl;
+      std::cout << "Rows per tile         [" << aggr_opts.tile_rows << "]" << std::endl;
+      std::cout << "Aggregation pool      [" << PoolKindName(pool_kind) << "]" << std::endl;
+      std::cout << "Thread count          [" << aggr_opts.thread_count << "]" << std::endl;
+      std::cout << "Column partitions     [" << aggr_opts.col_partitions << "]" << std::endl;
+      std::cout << "Decode threads        [" << decode_threads << "]" << std::endl;
+      std::cout << "Slice queue depth     [" << qdepth << "]" << std::endl;
       std::cout << "Batch count to concat [" << batch_count  << "]" << std::endl;
       std::cout << "Column limit to aggr  [" << col_limit << "]" << std::endl;
+      std::cout << "Batch range to read   ["
+                << read_proj.batch_startndx << ":" << read_proj.batch_limit
+                << "]" << std::endl
+      ;
     #endif
 
+    // compressed buffers are decompressed on arrow's CPU thread pool; row ranges and column
+    // partitions are accumulated on a pool of their own, so each is sized independently
+    auto status_pool = arrow::SetCpuThreadPoolCapacity(decode_threads);
+    if (not status_pool.ok()) {
+      std::cerr << "Couldn't resize thread pool:"   << std::endl
+                << "\t" << status_pool.ToString() << std::endl
+      ;
 
-    // ----------
-    // Read sample data from file
-    auto reader_result = ReadIPCFile(test_fpath);
-    if (not reader_result.ok()) {
-      std::cerr << "Couldn't read file:"                     << std::endl
-                << "\t" << reader_result.status().ToString() << std::endl
+      return 1;
+    }
+
+    auto aggr_pool_result = arrow::internal::ThreadPool::Make(
+        std::max(aggr_opts.thread_count, aggr_opts.col_partitions)
+    );
+    if (not aggr_pool_result.ok()) {
+      std::cerr << "Couldn't create thread pool:"                << std::endl
+                << "\t" << aggr_pool_result.status().ToString() << std::endl
       ;
 
       return 1;
     }
 
+    auto aggr_threads = *aggr_pool_result;
+
+
+    // Aggregation state, results and compute intermediates come from the selected pool;
+    // input data is always read into the default pool. The recycling pool allocates from
+    // the default pool, so the profile (of the default pool) counts only its misses.
+    // Either pool is timed, so runs with each one report the time spent allocating.
+    unique_ptr<RecyclingMemoryPool> recycling_pool;
+    if (pool_kind == PoolKind::Recycling) {
+        recycling_pool = std::make_unique<RecyclingMemoryPool>();
+    }
+
+    TimedMemoryPool aggr_timedpool {
+        recycling_pool ? recycling_pool.get() : arrow::default_memory_pool()
+    };
+
+    ExecContext aggr_ctx { &aggr_timedpool, aggr_threads.get() };
+    aggr_opts.exec_ctx = &aggr_ctx;
+
+
     // ----------
-    // Peek at the data
-    auto data_table = *reader_result;
-    auto pkey_col   = data_table->column(0);
+    // Phases of the run are profiled; hardware counters are only opened when the profile
+    // is written
+    RunProfile run_profile { arrow::default_memory_pool(), not profile_fpath.empty() };
+    run_profile.SetParam("mode"        , should_aggrtable);
+    run_profile.SetParam("input"       , test_fpath);
+    run_profile.SetParam("io"          , IOStrategyName(io_strategy));
+    run_profile.SetParam("kernel"      , AggrKernelName(aggr_opts.kernel));
+    run_profile.SetParam("alloc"       , PoolKindName(pool_kind));
+    run_profile.SetParam("batch_count" , static_cast<int64_t>(batch_count));
+    run_profile.SetParam("col_limit"   , col_limit);
+    run_profile.SetParam("threads"     , aggr_opts.thread_count);
+    run_profile.SetParam("partitions"  , aggr_opts.col_partitions);
+    run_profile.SetParam("decode"      , decode_threads);
+    run_profile.SetParam("qdepth"      , qdepth);
 
-    #if DEBUG != 0
-      std::cout << "Table dimensions ["
-                <<     data_table->num_rows() << ", " << data_table->num_columns()
-                << "]"
-                << std::endl
-                << "\t" << "[" << pkey_col->num_chunks()       << "] chunks"
-                << std::endl
-                << "\t" << "[" << pkey_col->chunk(0)->length() << "] chunk_size"
-                << std::endl
-      ;
-    #endif
+    // ----------
+    // Read sample data from file (or open a stream of its batches)
+    auto run_tstart = std::chrono::steady_clock::now();
+
+    shared_ptr<Table>             data_table;
+    unique_ptr<RecordBatchReader> data_stream;
+    int64_t                       data_rowcount { 0 };
+
+    if (aggr_stream) {
+      auto stream_result = run_profile.Measure("load", [&]() {
+          return StreamIPCFile(test_fpath, &data_rowcount, io_strategy, read_proj);
+      });
+      if (not stream_result.ok()) {
+        std::cerr << "Couldn't stream file:"                   << std::endl
+                  << "\t" << stream_result.status().ToString() << std::endl
+        ;
+
+        return 1;
+      }
+
+      data_stream = std::move(stream_result).ValueOrDie();
+    }
+
+    else {
+      auto reader_result = run_profile.Measure("load", [&]() {
+          return ReadIPCFile(test_fpath, io_strategy, read_proj);
+      });
+      if (not reader_result.ok()) {
+        std::cerr << "Couldn't read file:"                     << std::endl
+                  << "\t" << reader_result.status().ToString() << std::endl
+        ;
+
+        return 1;
+      }
+
+      data_table    = *reader_result;
+      data_rowcount = data_table->num_rows();
+
+      // ----------
+      // Peek at the data
+      #if DEBUG != 0
+        auto pkey_col = data_table->column(0);
+        std::cout << "Table dimensions ["
+                  <<     data_table->num_rows() << ", " << data_table->num_columns()
+                  << "]"
+                  << std::endl
+                  << "\t" << "[" << pkey_col->num_chunks()       << "] chunks"
+                  << std::endl
+                  << "\t" << "[" << pkey_col->chunk(0)->length() << "] chunk_size"
+                  << std::endl
+        ;
+      #endif
+    }
+
+    // time to load the table (or, when streaming, to open the file and read its footer)
+    std::chrono::nanoseconds load_ttime { std::chrono::steady_clock::now() - run_tstart };
 
     // >> The computation to be benchmarked
-    std::chrono::milliseconds aggr_ttime { 0 };
-    int                       aggr_count { 0 };
-    shared_ptr<Table>         aggr_result;
+    std::chrono::nanoseconds aggr_ttime { 0 };
+    int                      aggr_count { 0 };
+    shared_ptr<Table>        aggr_result;
+
+    // time from the start of reading until the first (partial) result is available; there
+    // is none if no slice was aggregated
+    std::optional<std::chrono::steady_clock::time_point> first_result;
 
-    //  |> case for applying computation to whole table
+    // time the read and aggregate stages spend working, or waiting on each other
+    StageTime read_stage;
+    StageTime aggr_stage;
+
+    //  |> case for applying computation to whole table (accumulating and taking the
+    //     result are separate phases, as they are for slices)
     if (aggr_table) {
-      aggr_ttime += AggrTable(data_table, 1, col_limit, &aggr_result);
-      aggr_count  = 1;
+      MeanAggr table_aggr  { aggr_opts };
+      int64_t  col_stopndx = AggrColumnStop(data_table, 1, col_limit);
+
+      auto aggr_tstart = std::chrono::steady_clock::now();
+      auto aggr_status = run_profile.Measure("accumulate", [&]() {
+          return table_aggr.Accumulate(data_table, 1, col_stopndx);
+      });
+      aggr_ttime += std::chrono::steady_clock::now() - aggr_tstart;
+
+      if (not aggr_status.ok()) {
+        std::cerr << "Failed to aggregate table"    << std::endl
+                  << "\t" << aggr_status.ToString() << std::endl
+        ;
+
+        return 3;
+      }
+
+      aggr_result  = run_profile.Measure("take result", [&]() { return table_aggr.TakeResult(); });
+      aggr_count   = 1;
+      first_result = std::chrono::steady_clock::now();
+
+      // the whole table is read before it is aggregated
+      aggr_stage.busy = *first_result - aggr_tstart;
+      aggr_stage.idle = load_ttime;
+      read_stage.busy = load_ttime;
+      read_stage.idle = aggr_stage.busy;
 
       #if DEBUG == 0
         std::cout <<         data_table->num_rows()
-                  << "," << ((col_limit > 0) ? col_limit : data_table->num_columns())
+                  << "," << ((col_limit > 0) ? col_limit : AggrColumnCount(data_table))
         ;
       #endif
     }
 
-    //  |> case for applying computation to each table chunk (i.e. RecordBatch)
+    //  |> case for applying computation to each table chunk (i.e. RecordBatch), whether
+    //     sliced from the table in memory or streamed from the file
     else {
-      std::vector<shared_ptr<Table>> aggrs_by_slice;
-      aggrs_by_slice.reserve(pkey_col->num_chunks());
+      // Each slice is aggregated into its rows of a single result; see `SliceAggr`
+      SliceAggr slice_aggr { aggr_opts, data_rowcount };
 
       // Use `TableBatchReader` to grab chunks from the table
-      auto   table_batcher = arrow::TableBatchReader(*data_table);
-      auto   slice_result  = ReadBatchesFromTable(table_batcher, batch_count);
+      unique_ptr<RecordBatchReader> table_batcher;
+      if (not aggr_stream) {
+        table_batcher = std::make_unique<arrow::TableBatchReader>(*data_table);
+      }
+
+      RecordBatchReader &batch_reader = aggr_stream ? *data_stream : *table_batcher;
+
+      // With a queue depth, slices are read on another thread while earlier slices are
+      // aggregated; otherwise each slice is read only after the previous one is aggregated
+      unique_ptr<SlicePrefetcher> slice_prefetcher;
+      if (qdepth > 0) {
+        slice_prefetcher = std::make_unique<SlicePrefetcher>(batch_reader, batch_count, qdepth);
+      }
+
+      // (reading and combining batches is "read slice"; waiting on the prefetcher for a
+      // slice it read is "wait slice")
+      auto ReadNextSlice = [&]() {
+        if (slice_prefetcher) {
+          return run_profile.Measure("wait slice", [&]() { return slice_prefetcher->Next(); });
+        }
+
+        auto read_tstart = std::chrono::steady_clock::now();
+        auto slice_data  = run_profile.Measure("read slice", [&]() {
+            return ReadBatchesFromTable(batch_reader, batch_count);
+        });
+        read_stage.busy += std::chrono::steady_clock::now() - read_tstart;
+
+        return slice_data;
+      };
+
+      auto slice_result = ReadNextSlice();
 
       if (slice_result.ok()) {
         #if DEBUG != 0
@@ -145,7 +551,7 @@ int main(int argc, char **argv) {
           ;
 
           std::cout << "Row count for final slice: ["
-                    << data_table->num_rows() % (*slice_result)->num_rows()
+                    << data_rowcount % (*slice_result)->num_rows()
                     << "]"
                     << std::endl
           ;
@@ -154,10 +560,10 @@ int main(int argc, char **argv) {
           std::cout << "\""
                        << (*slice_result)->num_rows()
                        << ":"
-                       << data_table->num_rows() % (*slice_result)->num_rows()
+                       << data_rowcount % (*slice_result)->num_rows()
                     << "\""
                     << ","
-                    << ((col_limit > 0) ? col_limit : (*slice_result)->num_columns())
+                    << ((col_limit > 0) ? col_limit : AggrColumnCount(*slice_result))
           ;
 
         #endif
@@ -165,44 +571,211 @@ int main(int argc, char **argv) {
 
       // Iterate over each chunk and time the aggregation
       while (slice_result.ok()) {
-        // Aggregate table and save result
-        auto tslice = *slice_result;
-        aggr_ttime  += AggrTable(tslice, 1, col_limit, &aggr_result);
-        aggrs_by_slice.push_back(aggr_result);
+        // Aggregate slice into the result
+        auto tslice      = *slice_result;
+        auto aggr_tstart = std::chrono::steady_clock::now();
+        aggr_ttime      += run_profile.Measure("accumulate", [&]() {
+            return slice_aggr.AggrSlice(tslice, 1, col_limit);
+        });
+        auto aggr_tstop  = std::chrono::steady_clock::now();
+
+        aggr_stage.busy += aggr_tstop - aggr_tstart;
+        if (aggr_count == 0) { first_result = aggr_tstop; }
 
         // Read next batch
-        slice_result = ReadBatchesFromTable(table_batcher, batch_count);
+        slice_result = ReadNextSlice();
 
         // Count iterations
         ++aggr_count;
       }
 
-      // Aggregate results but this doesn't directly affect the experiment
-      auto concat_result = arrow::ConcatenateTables(aggrs_by_slice);
-      if (not concat_result.ok()) {
-        std::cerr << "Failed to concatenate partial aggr results" << std::endl
-                  << "\t" << concat_result.status().ToString()    << std::endl
+      // only the end of the batches stops the loop cleanly; a decode or IO failure
+      // partway through the input fails the run instead of truncating it. With a queue
+      // depth, the prefetcher hands back the error its read thread stopped on.
+      if (not IsEndOfBatches(slice_result.status())) {
+        std::cerr << (slice_prefetcher ? "Failed to prefetch slice" : "Failed to read slice")
+                  << std::endl
+                  << "\t" << slice_result.status().ToString()  << std::endl
+        ;
+
+        return 1;
+      }
+
+      if (not slice_aggr.status().ok()) {
+        std::cerr << "Failed to aggregate slices"              << std::endl
+                  << "\t" << slice_aggr.status().ToString()    << std::endl
+        ;
+
+        return 3;
+      }
+
+      if (slice_aggr.rows_aggregated() != data_rowcount) {
+        std::cerr << "Aggregated "  << slice_aggr.rows_aggregated()
+                  << " of "         << data_rowcount
+                  << " rows"        << std::endl
         ;
 
         return 3;
       }
 
-      aggr_result = *concat_result;
+      aggr_result = run_profile.Measure("take result", [&]() { return slice_aggr.TakeResult(); });
+
+      // When serial, each stage is idle while the other one works
+      if (slice_prefetcher) {
+        read_stage      = slice_prefetcher->ReadTime();
+        aggr_stage.idle = slice_prefetcher->WaitTime();
+      }
+
+      else {
+        read_stage.idle = aggr_stage.busy;
+        aggr_stage.idle = read_stage.busy;
+      }
+    }
+
+    std::optional<std::chrono::nanoseconds> first_ttime;
+    std::optional<std::chrono::nanoseconds> avg_ttime;
+    if (aggr_count > 0) {
+      first_ttime = *first_result - run_tstart;
+      avg_ttime   = aggr_ttime / aggr_count;
+    }
+
+    // peak bytes held by arrow's default pool, and peak resident set of the process
+    int64_t peak_poolbytes = arrow::default_memory_pool()->max_memory();
+    int64_t peak_rssbytes  = PeakResidentBytes();
+
+    // >> Verification and scaling re-aggregate the whole table; load it if we streamed
+    if ((should_verify or should_scale) and data_table == nullptr) {
+      auto reader_result = ReadIPCFile(test_fpath, io_strategy, read_proj);
+      if (not reader_result.ok()) {
+        std::cerr << "Couldn't read file:"                     << std::endl
+                  << "\t" << reader_result.status().ToString() << std::endl
+        ;
+
+        return 1;
+      }
+
+      data_table = *reader_result;
+    }
+
+    // >> Compare against a reference kernel (vec, or fused when checking vec). Rows are
+    //    independent, so concatenated slice aggregates should match a whole-table aggregate.
+    if (should_verify) {
+      AggrOptions verify_opts;
+      verify_opts.kernel = (
+          aggr_opts.kernel == AggrKernel::Vec ? AggrKernel::Fused : AggrKernel::Vec
+      );
+
+      // the matrix layout and float32 samples are checked against the wide, float64 data;
+      // for float32, the difference is the precision lost by narrowing the input
+      shared_ptr<Table> verify_table = data_table;
+      if (use_matrix or use_float32) {
+        auto reader_result = ReadIPCFile(wide_fpath, io_strategy, read_proj);
+        if (not reader_result.ok()) {
+          std::cerr << "Couldn't read file:"                     << std::endl
+                    << "\t" << reader_result.status().ToString() << std::endl
+          ;
+
+          return 1;
+        }
+
+        verify_table = *reader_result;
+      }
+
+      shared_ptr<Table> verify_result;
+      auto verify_ttime = run_profile.Measure("verify", [&]() {
+          return AggrTable(verify_table, 1, col_limit, &verify_result, verify_opts);
+      });
+
+      auto diff_result = MaxAbsDifference(aggr_result, verify_result);
+      if (not diff_result.ok()) {
+        std::cerr << "Failed to compare results"             << std::endl
+                  << "\t" << diff_result.status().ToString() << std::endl
+        ;
+
+        return 4;
+      }
+
+      std::cerr << "Verify [" << AggrKernelName(aggr_opts.kernel)
+                << " vs "     << AggrKernelName(verify_opts.kernel) << "]:" << std::endl
+                << "\tmax abs diff: " << *diff_result                    << std::endl
+                << "\t" << AggrKernelName(verify_opts.kernel) << " time: "
+                         << ToMillis(verify_ttime) << "ms"                << std::endl
+      ;
     }
 
     #if DEBUG != 0
       std::cout << "Aggr Time:"                                           << std::endl
-                << "\tTotal: " << aggr_ttime.count()              << "ms" << std::endl
-                << "\tAvg  : " << aggr_ttime.count() / aggr_count << "ms" << std::endl
+                << "\tTotal: " << ToMillis(aggr_ttime)              << "ms" << std::endl
+                << "\tAvg  : " << MillisText(avg_ttime)                   << std::endl
+                << "\tFirst result: " << MillisText(first_ttime)          << std::endl
+                << "Load Time [" << IOStrategyName(io_strategy) << "]: "
+                                 << ToMillis(load_ttime)            << "ms" << std::endl
+                << "Stage Time (busy / idle) [qdepth " << qdepth << "]:"  << std::endl
+                << "\tread: " << ToMillis(read_stage.busy) << "ms / "
+                              << ToMillis(read_stage.idle) << "ms"        << std::endl
+                << "\taggr: " << ToMillis(aggr_stage.busy) << "ms / "
+                              << ToMillis(aggr_stage.idle) << "ms"        << std::endl
+                << "Peak memory:"                                         << std::endl
+                << "\tarrow pool: " << peak_poolbytes / (1 << 20) << "MiB" << std::endl
+                << "\tresident  : " << peak_rssbytes  / (1 << 20) << "MiB" << std::endl
       ;
 
     #else
-      std::cout << "," << "\"" << aggr_ttime.count()              << "ms" << "\""
-                << "," << "\"" << aggr_ttime.count() / aggr_count << "ms" << "\""
+      std::cout << "," << "\"" << ToMillis(aggr_ttime)              << "ms" << "\""
+                << "," << "\"" << MillisText(avg_ttime)                   << "\""
+                << "," << "\"" << MillisText(first_ttime)                 << "\""
+                << "," << "\"" << peak_poolbytes / (1 << 20)      << "MiB" << "\""
+                << "," << "\"" << peak_rssbytes  / (1 << 20)      << "MiB" << "\""
+                << "," << "\"" << ToMillis(load_ttime)              << "ms" << "\""
+                << "," << "\"" << ToMillis(read_stage.busy)       << "ms" << "\""
+                << "," << "\"" << ToMillis(read_stage.idle)       << "ms" << "\""
+                << "," << "\"" << ToMillis(aggr_stage.busy)       << "ms" << "\""
+                << "," << "\"" << ToMillis(aggr_stage.idle)       << "ms" << "\""
                 << std::endl
       ;
 
     #endif
 
+    // >> Time whole-table aggregation as the thread count doubles, up to the requested count
+    if (should_scale) {
+      std::cerr << "threads,aggr time,speedup" << std::endl;
+
+      AggrOptions scaling_opts = aggr_opts;
+      double      base_ttime   = 0;
+      for (int thread_count = 1; ; thread_count = std::min(thread_count * 2, aggr_opts.thread_count)) {
+        shared_ptr<Table> scaling_result;
+
+        scaling_opts.thread_count = thread_count;
+        auto scaling_ttime = run_profile.Measure("scaling", [&]() {
+            return AggrTable(data_table, 1, col_limit, &scaling_result, scaling_opts);
+        });
+        if (thread_count == 1) { base_ttime = std::max<double>(scaling_ttime.count(), 1); }
+
+        std::cerr <<         thread_count
+                  << "," << "\"" << ToMillis(scaling_ttime) << "ms" << "\""
+                  << "," << base_ttime / std::max<double>(scaling_ttime.count(), 1)
+                  << std::endl
+        ;
+
+        if (thread_count == aggr_opts.thread_count) { break; }
+      }
+    }
+
+    auto alloc_time = aggr_timedpool.Times();
+    run_profile.SetParam("alloc_calls", alloc_time.call_count);
+    run_profile.SetParam("alloc_ns"   , alloc_time.call_time.count());
+
+    if (recycling_pool) {
+      auto recycle_stats = recycling_pool->Stats();
+      run_profile.SetParam("pool_hits"        , recycle_stats.hit_count);
+      run_profile.SetParam("pool_misses"      , recycle_stats.miss_count);
+      run_profile.SetParam("pool_cached_bytes", recycle_stats.cached_bytes);
+    }
+
+    if (not profile_fpath.empty() and not WriteProfile(run_profile, profile_fpath)) {
+      std::cerr << "Couldn't write profile to [" << profile_fpath << "]" << std::endl;
+      return 5;
+    }
+
     return 0;
 }
@@ -31,6 +31,9 @@
 #include "adapter_arrow.hpp"
 #include "util_arrow.hpp"
 #include "operators.hpp"
+#include "partition_store.hpp"
+#include "instrument.hpp"
+#include "recycling_pool.hpp"
 
 
 // ------------------------------
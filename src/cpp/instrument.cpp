@@ -0,0 +1,313 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+// ------------------------------
+// Dependencies
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include <sys/resource.h>
+
+#if defined(__linux__)
+  #include <linux/perf_event.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+#include "instrument.hpp"
+
+
+// ------------------------------
+// Functions
+
+double
+ToMillis(std::chrono::nanoseconds duration) {
+    return MillisDouble(duration).count();
+}
+
+// ru_maxrss is in KiB on linux
+int64_t
+PeakResidentBytes() {
+    struct rusage proc_usage;
+    if (getrusage(RUSAGE_SELF, &proc_usage) != 0) { return 0; }
+
+    return static_cast<int64_t>(proc_usage.ru_maxrss) * 1024;
+}
+
+#if defined(__linux__)
+  // A counter of user-space events of the calling thread, on any CPU; counting starts now.
+  // Counters of 1 group (`group_fd`, or -1 to lead a new group) are scheduled onto the
+  // PMU together. Reads also return the time the counter was enabled and running, which
+  // differ when the kernel multiplexes counters.
+  static int
+  OpenPerfCounter(uint32_t event_type, uint64_t event_config, int group_fd) {
+      struct perf_event_attr event_attr;
+      std::memset(&event_attr, 0, sizeof(event_attr));
+
+      event_attr.size           = sizeof(event_attr);
+      event_attr.type           = event_type;
+      event_attr.config         = event_config;
+      event_attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      event_attr.exclude_kernel = 1;
+      event_attr.exclude_hv     = 1;
+
+      return static_cast<int>(
+          syscall(SYS_perf_event_open, &event_attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC)
+      );
+  }
+
+  // value, time enabled, time running (see `read_format`)
+  struct PerfReading {
+      uint64_t counter_val;
+      uint64_t time_enabled;
+      uint64_t time_running;
+  };
+#endif
+
+static std::string
+QuoteJson(const std::string &json_str) {
+    std::string quoted_str { "\"" };
+
+    for (char str_char : json_str) {
+        switch (str_char) {
+            case '"' : { quoted_str += "\\\""; break; }
+            case '\\': { quoted_str += "\\\\"; break; }
+            case '\n': { quoted_str += "\\n";  break; }
+            case '\t': { quoted_str += "\\t";  break; }
+
+            default: {
+                if (static_cast<unsigned char>(str_char) < 0x20) { continue; }
+                quoted_str += str_char;
+            }
+        }
+    }
+
+    return quoted_str + "\"";
+}
+
+// unavailable counts are null
+static std::string
+CountJson(int64_t count_val) {
+    return count_val < 0 ? "null" : std::to_string(count_val);
+}
+
+// difference of 2 counts; unavailable if either is
+static int64_t
+CountDelta(int64_t start_count, int64_t stop_count) {
+    return (start_count < 0 or stop_count < 0) ? -1 : stop_count - start_count;
+}
+
+// sum of 2 counts; a sum over calls is unavailable if any call's count is
+static int64_t
+CountSum(int64_t left_count, int64_t right_count) {
+    return (left_count < 0 or right_count < 0) ? -1 : left_count + right_count;
+}
+
+
+// >> PerfCounters
+
+PerfCounters::PerfCounters() {
+    #if defined(__linux__)
+      constexpr uint64_t llc_read_misses = (
+            PERF_COUNT_HW_CACHE_LL
+          | (PERF_COUNT_HW_CACHE_OP_READ     << 8 )
+          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+      );
+
+      // cycles lead the group; a counter that can't join it (e.g. no cycles counter) is
+      // opened on its own
+      counter_fds[0] = OpenPerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+      counter_fds[1] = OpenPerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, counter_fds[0]);
+      counter_fds[2] = OpenPerfCounter(PERF_TYPE_HW_CACHE, llc_read_misses, counter_fds[0]);
+    #endif
+}
+
+PerfCounters::~PerfCounters() {
+    #if defined(__linux__)
+      for (int counter_fd : counter_fds) {
+          if (counter_fd >= 0) { close(counter_fd); }
+      }
+    #endif
+}
+
+bool
+PerfCounters::available() const {
+    for (int counter_fd : counter_fds) {
+        if (counter_fd >= 0) { return true; }
+    }
+
+    return false;
+}
+
+PerfCounts
+PerfCounters::Read() const {
+    std::array<int64_t, 3> counter_vals { -1, -1, -1 };
+
+    #if defined(__linux__)
+      for (size_t counter_ndx = 0; counter_ndx < counter_fds.size(); ++counter_ndx) {
+          PerfReading counter_reading;
+
+          if (    counter_fds[counter_ndx] < 0
+              or  read(counter_fds[counter_ndx], &counter_reading, sizeof(counter_reading))
+                  != sizeof(counter_reading)
+              or  counter_reading.time_running == 0) {
+              continue;
+          }
+
+          // a multiplexed counter only counted while it was running; scale it to the
+          // time it was enabled
+          double counter_scale = (
+                static_cast<double>(counter_reading.time_enabled)
+              / static_cast<double>(counter_reading.time_running)
+          );
+
+          counter_vals[counter_ndx] = static_cast<int64_t>(
+              static_cast<double>(counter_reading.counter_val) * counter_scale
+          );
+      }
+    #endif
+
+    PerfCounts perf_counts;
+    perf_counts.cycles       = counter_vals[0];
+    perf_counts.instructions = counter_vals[1];
+    perf_counts.llc_misses   = counter_vals[2];
+
+    return perf_counts;
+}
+
+
+// >> RunProfile
+
+RunProfile::RunProfile(MemoryPool *memory_pool, bool use_perf)
+  : memory_pool(memory_pool), run_start(std::chrono::steady_clock::now()) {
+    if (use_perf) { perf_counters = std::make_unique<PerfCounters>(); }
+}
+
+void
+RunProfile::SetParam(const std::string &param_name, const std::string &param_val) {
+    run_params.emplace_back(param_name, QuoteJson(param_val));
+}
+
+void
+RunProfile::SetParam(const std::string &param_name, int64_t param_val) {
+    run_params.emplace_back(param_name, std::to_string(param_val));
+}
+
+const PhaseStats *
+RunProfile::Phase(const std::string &phase_name) const {
+    for (const auto &named_stats : phase_stats) {
+        if (named_stats.first == phase_name) { return &named_stats.second; }
+    }
+
+    return nullptr;
+}
+
+RunProfile::PhaseMark
+RunProfile::Mark() const {
+    PhaseMark phase_mark;
+    phase_mark.bytes_allocated = memory_pool->total_bytes_allocated();
+    phase_mark.alloc_count     = memory_pool->num_allocations();
+    if (perf_counters) { phase_mark.perf_counts = perf_counters->Read(); }
+
+    // last, so reading the counters isn't part of the phase's time
+    phase_mark.mark_time = std::chrono::steady_clock::now();
+
+    return phase_mark;
+}
+
+void
+RunProfile::Record(const std::string &phase_name, const PhaseMark &start_mark) {
+    auto stop_time  = std::chrono::steady_clock::now();
+    auto stop_mark  = Mark();
+
+    auto named_stats = std::find_if(
+         phase_stats.begin(), phase_stats.end()
+        ,[&phase_name](const auto &named_stats) { return named_stats.first == phase_name; }
+    );
+
+    if (named_stats == phase_stats.end()) {
+        phase_stats.emplace_back(phase_name, PhaseStats {});
+        named_stats = std::prev(phase_stats.end());
+    }
+
+    auto &stats = named_stats->second;
+    stats.call_count      += 1;
+    stats.wall_time       += stop_time - start_mark.mark_time;
+    stats.bytes_allocated += stop_mark.bytes_allocated - start_mark.bytes_allocated;
+    stats.alloc_count     += stop_mark.alloc_count     - start_mark.alloc_count;
+    stats.pool_peak_bytes  = memory_pool->max_memory();
+
+    // the first call starts each sum from 0
+    const auto &start_perf = start_mark.perf_counts;
+    const auto &stop_perf  = stop_mark.perf_counts;
+    auto       &sum_perf   = stats.perf_counts;
+    bool        is_first   = (stats.call_count == 1);
+
+    sum_perf.cycles       = CountSum(is_first ? 0 : sum_perf.cycles      , CountDelta(start_perf.cycles      , stop_perf.cycles      ));
+    sum_perf.instructions = CountSum(is_first ? 0 : sum_perf.instructions, CountDelta(start_perf.instructions, stop_perf.instructions));
+    sum_perf.llc_misses   = CountSum(is_first ? 0 : sum_perf.llc_misses  , CountDelta(start_perf.llc_misses  , stop_perf.llc_misses  ));
+}
+
+std::string
+RunProfile::ToJson() const {
+    auto run_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - run_start
+    );
+
+    std::stringstream run_json;
+    run_json << "{\"params\":{";
+    for (size_t param_ndx = 0; param_ndx < run_params.size(); ++param_ndx) {
+        run_json << (param_ndx > 0 ? "," : "")
+                 << QuoteJson(run_params[param_ndx].first) << ":" << run_params[param_ndx].second;
+    }
+
+    run_json << "}"
+             << ",\"wall_ns\":"        << run_time.count()
+             << ",\"perf_available\":" << ((perf_counters and perf_counters->available()) ? "true" : "false")
+             << ",\"pool\":{"
+             <<     "\"backend\":"         << QuoteJson(memory_pool->backend_name())
+             <<    ",\"bytes_allocated\":" << memory_pool->total_bytes_allocated()
+             <<    ",\"alloc_count\":"     << memory_pool->num_allocations()
+             <<    ",\"peak_bytes\":"      << memory_pool->max_memory()
+             <<    ",\"current_bytes\":"   << memory_pool->bytes_allocated()
+             << "}"
+             << ",\"phases\":["
+    ;
+
+    for (size_t phase_ndx = 0; phase_ndx < phase_stats.size(); ++phase_ndx) {
+        const auto &stats = phase_stats[phase_ndx].second;
+
+        run_json << (phase_ndx > 0 ? "," : "")
+                 << "{\"name\":"            << QuoteJson(phase_stats[phase_ndx].first)
+                 << ",\"calls\":"           << stats.call_count
+                 << ",\"wall_ns\":"         << stats.wall_time.count()
+                 << ",\"bytes_allocated\":" << stats.bytes_allocated
+                 << ",\"alloc_count\":"     << stats.alloc_count
+                 << ",\"pool_peak_bytes\":" << stats.pool_peak_bytes
+                 << ",\"cycles\":"          << CountJson(stats.perf_counts.cycles)
+                 << ",\"instructions\":"    << CountJson(stats.perf_counts.instructions)
+                 << ",\"llc_misses\":"      << CountJson(stats.perf_counts.llc_misses)
+                 << "}"
+        ;
+    }
+
+    run_json << "]}";
+    return run_json.str();
+}
@@ -0,0 +1,143 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+// ------------------------------
+// Dependencies
+#pragma once
+
+#include <array>
+#include <type_traits>
+#include <utility>
+
+#include "adapter_arrow.hpp"
+
+
+// ------------------------------
+// Timing and memory helpers
+
+// Durations in fractional milliseconds, so sub-millisecond times aren't truncated to 0
+using MillisDouble = std::chrono::duration<double, std::milli>;
+
+double ToMillis(std::chrono::nanoseconds duration);
+
+// Peak resident set size of this process, in bytes; 0 if it can't be read
+int64_t PeakResidentBytes();
+
+
+// ------------------------------
+// Run instrumentation
+//
+// A `RunProfile` breaks a run into named phases (e.g. "load", "read slice", "accumulate")
+// and records, per phase: calls, wall time, activity of an arrow memory pool, and, where
+// the kernel allows it, hardware counters. Calls of the same phase are summed, so a phase
+// that runs once per slice reports its total over the run. `ToJson` writes the profile as
+// 1 JSON record.
+
+// -1 when the counter isn't available
+struct PerfCounts {
+    int64_t cycles       { -1 };
+    int64_t instructions { -1 };
+    int64_t llc_misses   { -1 };  // last-level cache read misses
+};
+
+// User-space hardware counters of the calling thread, via perf_event_open. Work done on
+// other threads (e.g. arrow's CPU pool) is not counted. Counters can be unavailable, e.g.
+// in a VM without a PMU or when perf_event_paranoid forbids them. The counters are opened
+// as 1 group, so they count over the same intervals; if the kernel multiplexes them,
+// counts are scaled to the time they were enabled.
+class PerfCounters {
+  public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &)            = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool       available() const;
+    PerfCounts Read() const;
+
+  private:
+    // cycles (group leader), instructions, last-level cache read misses; -1 when not open
+    std::array<int, 3> counter_fds { -1, -1, -1 };
+};
+
+struct PhaseStats {
+    int64_t                  call_count      { 0 };
+    std::chrono::nanoseconds wall_time       { 0 };
+
+    // from the memory pool: bytes and allocations made during the phase, and the pool's
+    // peak (over the process) when the phase last ended
+    int64_t                  bytes_allocated { 0 };
+    int64_t                  alloc_count     { 0 };
+    int64_t                  pool_peak_bytes { 0 };
+
+    PerfCounts               perf_counts;
+};
+
+class RunProfile {
+  public:
+    explicit RunProfile( MemoryPool *memory_pool = arrow::default_memory_pool()
+                        ,bool        use_perf    = true);
+
+    // Runs `phase_fn` as (another call of) phase `phase_name`, and returns its result
+    template<typename PhaseFnType>
+    auto Measure(const std::string &phase_name, PhaseFnType &&phase_fn) -> decltype(phase_fn()) {
+        auto start_mark = Mark();
+
+        if constexpr (std::is_void_v<decltype(phase_fn())>) {
+            phase_fn();
+            Record(phase_name, start_mark);
+        }
+
+        else {
+            auto phase_result = phase_fn();
+            Record(phase_name, start_mark);
+
+            return phase_result;
+        }
+    }
+
+    // Parameters of the run (e.g. mode and batch count), written with the profile
+    void SetParam(const std::string &param_name, const std::string &param_val);
+    void SetParam(const std::string &param_name, int64_t param_val);
+
+    const PhaseStats *Phase(const std::string &phase_name) const;
+
+    // 1 line, in the order phases first ran
+    std::string ToJson() const;
+
+  private:
+    struct PhaseMark {
+        std::chrono::steady_clock::time_point mark_time;
+        int64_t                               bytes_allocated;
+        int64_t                               alloc_count;
+        PerfCounts                            perf_counts;
+    };
+
+    PhaseMark Mark() const;
+    void      Record(const std::string &phase_name, const PhaseMark &start_mark);
+
+    MemoryPool                           *memory_pool;
+    unique_ptr<PerfCounters>              perf_counters;
+    std::chrono::steady_clock::time_point run_start;
+
+    // parameter values are kept as JSON (quoted strings, or numbers)
+    std::vector<std::pair<std::string, std::string>> run_params;
+    std::vector<std::pair<std::string, PhaseStats>>  phase_stats;
+};
@@ -0,0 +1,180 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+
+#include <algorithm>
+#include <mutex>
+
+#include "kernels_arrow.hpp"
+
+
+// ------------------------------
+// Type Aliases
+
+using arrow::compute::Arity;
+using arrow::compute::ExecResult;
+using arrow::compute::ExecSpan;
+using arrow::compute::FunctionDoc;
+using arrow::compute::InputType;
+using arrow::compute::KernelContext;
+using arrow::compute::KernelSignature;
+using arrow::compute::MemAllocation;
+using arrow::compute::NullHandling;
+using arrow::compute::ScalarFunction;
+using arrow::compute::ScalarKernel;
+
+
+// ------------------------------
+// Helpers
+
+shared_ptr<DataType>
+WelfordStateType() {
+    return arrow::struct_({
+         arrow::field("count", arrow::uint64() )
+        ,arrow::field("mean" , arrow::float64())
+        ,arrow::field("m2"   , arrow::float64())
+    });
+}
+
+/**
+ * Welford update (the recurrence from `MeanAggr::Accumulate`) of every row's state with 1
+ * column of a float32 or float64 span; values are widened to double, so state is float64
+ * either way. Null values are skipped.
+ */
+template <typename CType>
+static void
+AddColumn( const arrow::ArraySpan &col_vals
+          ,uint64_t               *row_counts
+          ,double                 *row_means
+          ,double                 *row_m2) {
+    const CType *raw_vals = col_vals.GetValues<CType>(1);
+    bool         has_null = col_vals.GetNullCount() > 0;
+
+    for (int64_t row_ndx = 0; row_ndx < col_vals.length; ++row_ndx) {
+        if (has_null and not col_vals.IsValid(row_ndx)) { continue; }
+
+        double new_val       = static_cast<double>(raw_vals[row_ndx]);
+        row_counts[row_ndx] += 1;
+
+        double delta_mean   = new_val - row_means[row_ndx];
+        row_means[row_ndx] += delta_mean / static_cast<double>(row_counts[row_ndx]);
+        row_m2[row_ndx]    += (new_val - row_means[row_ndx]) * delta_mean;
+    }
+}
+
+
+// ------------------------------
+// Row-wise function: "welford_rows"
+
+// Each argument is 1 column; the columns are consumed in order, 1 pass each
+template <typename ArrowType>
+static Status
+WelfordRowsExec(KernelContext *ctx, const ExecSpan &batch, ExecResult *out) {
+    using CType = typename ArrowType::c_type;
+
+    int64_t row_count = batch.length;
+
+    ARROW_ASSIGN_OR_RAISE(auto count_buffer, ctx->Allocate(row_count * sizeof(uint64_t)));
+    ARROW_ASSIGN_OR_RAISE(auto mean_buffer , ctx->Allocate(row_count * sizeof(double)));
+    ARROW_ASSIGN_OR_RAISE(auto m2_buffer   , ctx->Allocate(row_count * sizeof(double)));
+
+    auto row_counts = reinterpret_cast<uint64_t *>(count_buffer->mutable_data());
+    auto row_means  = reinterpret_cast<double *>(mean_buffer->mutable_data());
+    auto row_m2     = reinterpret_cast<double *>(m2_buffer->mutable_data());
+
+    std::fill(row_counts, row_counts + row_count, uint64_t { 0 });
+    std::fill(row_means , row_means  + row_count, 0.0);
+    std::fill(row_m2    , row_m2     + row_count, 0.0);
+
+    for (int arg_ndx = 0; arg_ndx < batch.num_values(); ++arg_ndx) {
+        if (not batch[arg_ndx].is_array()) {
+            return Status::NotImplemented("welford_rows expects array arguments");
+        }
+
+        AddColumn<CType>(batch[arg_ndx].array, row_counts, row_means, row_m2);
+    }
+
+    auto state_type = WelfordStateType();
+    auto state_data = arrow::ArrayData::Make(state_type, row_count, { nullptr }, 0);
+    state_data->child_data = {
+         arrow::ArrayData::Make(arrow::uint64() , row_count, { nullptr, std::move(count_buffer) }, 0)
+        ,arrow::ArrayData::Make(arrow::float64(), row_count, { nullptr, std::move(mean_buffer)  }, 0)
+        ,arrow::ArrayData::Make(arrow::float64(), row_count, { nullptr, std::move(m2_buffer)    }, 0)
+    };
+
+    out->value = std::move(state_data);
+
+    return Status::OK();
+}
+
+
+// ------------------------------
+// Registration
+
+template <typename ArrowType>
+static Status
+AddRowsKernel(ScalarFunction &rows_fn, shared_ptr<DataType> value_type) {
+    ScalarKernel rows_kernel {
+         KernelSignature::Make({ InputType(value_type) }, WelfordStateType(), /*is_varargs=*/ true)
+        ,WelfordRowsExec<ArrowType>
+    };
+
+    // the kernel allocates its own (struct) output, which is never null
+    rows_kernel.null_handling         = NullHandling::OUTPUT_NOT_NULL;
+    rows_kernel.mem_allocation        = MemAllocation::NO_PREALLOCATE;
+    rows_kernel.can_write_into_slices = false;
+
+    return rows_fn.AddKernel(std::move(rows_kernel));
+}
+
+static Status
+AddWelfordFunctions(FunctionRegistry *registry) {
+    FunctionDoc rows_doc {
+         "Count, mean and sum of squared differences (M2) of each row across the arguments"
+        ,"Each argument is a column of 1 sample; rows are updated with Welford's online "
+         "update, 1 column at a time. Null values are skipped."
+        ,{ "*columns" }
+    };
+
+    auto rows_fn = std::make_shared<ScalarFunction>("welford_rows", Arity::VarArgs(1), rows_doc);
+
+    // float32 values are widened as they are consumed; state is float64 for both
+    ARROW_RETURN_NOT_OK(AddRowsKernel<arrow::DoubleType>(*rows_fn, arrow::float64()));
+    ARROW_RETURN_NOT_OK(AddRowsKernel<arrow::FloatType >(*rows_fn, arrow::float32()));
+
+    return registry->AddFunction(rows_fn);
+}
+
+Status
+RegisterWelfordFunctions(FunctionRegistry *registry) {
+    if (registry == nullptr) { registry = arrow::compute::GetFunctionRegistry(); }
+
+    // only the default registry is registered once; others are checked by name
+    if (registry == arrow::compute::GetFunctionRegistry()) {
+        static std::once_flag register_once;
+        static Status         register_status;
+
+        std::call_once(register_once, [&]() { register_status = AddWelfordFunctions(registry); });
+        return register_status;
+    }
+
+    if (registry->GetFunction("welford_rows").ok()) { return Status::OK(); }
+    return AddWelfordFunctions(registry);
+}
@@ -0,0 +1,49 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#pragma once
+
+#include "adapter_arrow.hpp"
+
+
+// ------------------------------
+// Type Aliases
+
+using arrow::compute::FunctionRegistry;
+
+
+// ------------------------------
+// Functions
+
+/**
+ * Registers the Welford mean/variance update (the same recurrence `MeanAggr` uses) as a
+ * native arrow compute function, so that arrow can drive it over a column batch:
+ *
+ *  - "welford_rows": row-wise over any number of float64 (or float32) columns of 1 type;
+ *                    arrow aligns the columns' chunks and calls the kernel per batch
+ *
+ * It produces struct<count: uint64, mean: float64, m2: float64> per row, where m2 is the
+ * sum of squared differences (variance = m2 / (count - 1)). Nulls are skipped.
+ * Registering more than once is a no-op.
+ */
+Status RegisterWelfordFunctions(FunctionRegistry *registry = nullptr);
+
+// The struct type produced by "welford_rows"
+shared_ptr<DataType> WelfordStateType();
@@ -0,0 +1,130 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#include <getopt.h>
+
+#include "experiments.hpp"
+
+
+// ------------------------------
+// Variables
+
+static std::string help_message {
+    "Usage: <loader> [options] <path-to-store> <partition-key> <path-to-feather>\n"
+    "\tWrites a feather file to a local partition store (a directory), in slices, under\n"
+    "\tthe given key; e.g. gene annotations under 'annotations/genes' for the t-test.\n"
+    "Options:\n"
+    "\t-s, --slice-rows <N>: rows per slice; each slice is 1 value in the store (default: 1024)\n"
+    "\t-a, --aggregate     : store the partial aggregate of the samples (key, mean and\n"
+    "\t                      variance per row, and the sample count as metadata) instead"
+};
+
+static const char *option_template = "s:a";
+
+static const struct option option_longnames[] = {
+     { "slice-rows", required_argument, nullptr, 's' }
+    ,{ "aggregate" , no_argument      , nullptr, 'a' }
+    ,{ nullptr     , 0                , nullptr,  0  }
+};
+
+
+// ------------------------------
+// Functions
+
+// The aggregate's state (see `MeanAggr::StateTable`), keyed by the source's key column
+static Result<shared_ptr<Table>>
+PartialAggregate(shared_ptr<Table> src_table) {
+    MeanAggr partial_aggr;
+    ARROW_RETURN_NOT_OK(partial_aggr.Accumulate(src_table));
+
+    return partial_aggr.StateTable(src_table->schema()->field(0), src_table->column(0));
+}
+
+int main(int argc, char **argv) {
+    // ----------
+    // Process CLI options, then positional args
+    int64_t slice_rows  { 1024  };
+    bool    should_aggr { false };
+
+    char parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    while (parsed_opt != (char) -1) {
+        switch (parsed_opt) {
+            case 's': { slice_rows  = std::stoll(optarg); break; }
+            case 'a': { should_aggr = true;               break; }
+
+            default: {
+                std::cerr << help_message << std::endl;
+                return 1;
+            }
+        }
+
+        parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    }
+
+    if (argc - optind != 3 or slice_rows <= 0) {
+      std::cerr << "Error: expected 3 arguments and a positive slice size." << std::endl
+                << help_message                                             << std::endl
+      ;
+      return 1;
+    }
+
+    std::string part_key { argv[optind + 1] };
+    auto reader_result = ReadIPCFile(UriForPath(argv[optind + 2]));
+    if (not reader_result.ok()) {
+      std::cerr << "Couldn't read file:"                     << std::endl
+                << "\t" << reader_result.status().ToString() << std::endl
+      ;
+
+      return 1;
+    }
+
+    auto part_table = *reader_result;
+    if (should_aggr) {
+        auto aggr_result = PartialAggregate(part_table);
+        if (not aggr_result.ok()) {
+          std::cerr << "Couldn't aggregate table:"             << std::endl
+                    << "\t" << aggr_result.status().ToString() << std::endl
+          ;
+
+          return 2;
+        }
+
+        part_table = *aggr_result;
+    }
+
+    LocalDirStore store { argv[optind] };
+    auto put_status = store.PutPartitionData(part_key, part_table, slice_rows);
+    if (not put_status.ok()) {
+      std::cerr << "Couldn't write partition:"   << std::endl
+                << "\t" << put_status.ToString() << std::endl
+      ;
+
+      return 3;
+    }
+
+    std::cout << "Stored [" << part_key << "]: "
+              << part_table->num_rows()            << " rows in "
+              << store.Stats().put_count - 1       << " slices, "
+              << store.Stats().bytes_written       << " bytes"
+              << std::endl
+    ;
+
+    return 0;
+}
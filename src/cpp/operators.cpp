@@ -20,8 +20,448 @@
 // Dependencies
 
 #include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <type_traits>
+
+#include <arrow/util/parallel.h>
+#include <arrow/util/thread_pool.h>
 
 #include "operators.hpp"
+#include "kernels_arrow.hpp"
+
+
+// ------------------------------
+// Functions
+
+// >> Kernel selection
+
+Result<AggrKernel>
+AggrKernelFromName(const std::string &kernel_name) {
+    if      (kernel_name == "vec"  ) { return AggrKernel::Vec;   }
+    else if (kernel_name == "fused") { return AggrKernel::Fused; }
+    else if (kernel_name == "tiled") { return AggrKernel::Tiled; }
+    else if (kernel_name == "arrow") { return AggrKernel::Arrow; }
+
+    return Status::Invalid("Unknown aggregation kernel: '", kernel_name, "'");
+}
+
+const char*
+AggrKernelName(AggrKernel kernel) {
+    switch (kernel) {
+        case AggrKernel::Vec:   return "vec";
+        case AggrKernel::Fused: return "fused";
+        case AggrKernel::Tiled: return "tiled";
+        case AggrKernel::Arrow: return "arrow";
+    }
+
+    return "unknown";
+}
+
+Status
+CheckLayoutKernel(const Schema &table_schema, AggrKernel kernel) {
+    if (IsMatrixLayout(table_schema) and kernel != AggrKernel::Fused) {
+        return Status::NotImplemented(
+            "The matrix layout has only the fused kernel; got '", AggrKernelName(kernel), "'"
+        );
+    }
+
+    return Status::OK();
+}
+
+MemoryPool*
+AggrOptions::memory_pool() const {
+    return exec_ctx != nullptr ? exec_ctx->memory_pool() : arrow::default_memory_pool();
+}
+
+Executor*
+AggrOptions::executor() const {
+    if (exec_ctx == nullptr or exec_ctx->executor() == nullptr) {
+        return arrow::internal::GetCpuThreadPool();
+    }
+
+    return exec_ctx->executor();
+}
+
+int64_t
+AggrColumnCount(shared_ptr<Table> table_data) {
+    return AggrColumnCount(*table_data->schema());
+}
+
+int64_t
+AggrColumnCount(const Schema &table_schema) {
+    if (not IsMatrixLayout(table_schema)) { return table_schema.num_fields(); }
+
+    auto block_type = std::static_pointer_cast<arrow::FixedSizeListType>(
+        table_schema.field(1)->type()
+    );
+
+    return 1 + block_type->list_size();
+}
+
+int64_t
+AggrColumnStop(shared_ptr<Table> table_data, int64_t col_startndx, int64_t col_limit) {
+    int64_t col_stopndx = AggrColumnCount(table_data);
+    if (col_limit > 0 and col_startndx + col_limit < col_stopndx) {
+        col_stopndx = col_startndx + col_limit;
+    }
+
+    return col_stopndx;
+}
+
+
+// >> Serialized aggregate state
+
+Result<uint64_t>
+GetAggrCount(shared_ptr<const KVMetadata> table_meta) {
+    if (table_meta == nullptr) {
+        return Status::KeyError("Aggregate state has no metadata; expected [", aggr_count_key, "]");
+    }
+
+    ARROW_ASSIGN_OR_RAISE(auto count_str, table_meta->Get(aggr_count_key));
+
+    // strtoull accepts a sign (and wraps "-1"), so the count must start with a digit
+    if (count_str.empty() or not std::isdigit(static_cast<unsigned char>(count_str[0]))) {
+        return Status::Invalid("Invalid [", aggr_count_key, "]: '", count_str, "'");
+    }
+
+    char     *count_end  = nullptr;
+    uint64_t  aggr_count = std::strtoull(count_str.c_str(), &count_end, 10);
+    if (*count_end != '\0') {
+        return Status::Invalid("Invalid [", aggr_count_key, "]: '", count_str, "'");
+    }
+
+    return aggr_count;
+}
+
+
+// >> Fused kernels
+
+/**
+ * Applies one column of new values to the running mean and M2 (sum of squared
+ * differences), in place. This is the same recurrence as `MeanAggr::Accumulate`, but
+ * each element makes a single trip through registers instead of one trip per compute
+ * call. There are no dependencies between rows, so the compiler can vectorize the loop.
+ * Values may be float32 or float64; they are widened, so state is always float64.
+ */
+template<typename ValueType>
+static void
+WelfordUpdate( const ValueType *__restrict new_vals
+              ,double          *__restrict means
+              ,double          *__restrict m2
+              ,int64_t                     row_count
+              ,double                      new_count) {
+    for (int64_t row_ndx = 0; row_ndx < row_count; ++row_ndx) {
+        double new_val     = static_cast<double>(new_vals[row_ndx]);
+        double delta_mean  = new_val - means[row_ndx];
+        means[row_ndx]    += delta_mean / new_count;
+        m2[row_ndx]       += (new_val - means[row_ndx]) * delta_mean;
+    }
+}
+
+// Sample values may be stored as float32 (half the bytes moved) or float64
+static bool
+IsSampleType(const DataType &value_type) {
+    return value_type.id() == arrow::Type::DOUBLE or value_type.id() == arrow::Type::FLOAT;
+}
+
+
+// The fused kernels read raw values, so they only accept float columns without nulls
+static Status
+CheckFusedColumn(shared_ptr<ChunkedArray> col_vals, int64_t col_ndx) {
+    if (not IsSampleType(*col_vals->type())) {
+        return Status::TypeError(
+            "Fused kernel expects float32 or float64 columns; column ", col_ndx
+           ," is ", col_vals->type()->ToString()
+        );
+    }
+
+    if (col_vals->null_count() > 0) {
+        return Status::Invalid(
+            "Fused kernel does not support null values (column ", col_ndx, ")"
+        );
+    }
+
+    return Status::OK();
+}
+
+// Tracks how far into a chunked column the tiled kernel has read
+struct ColumnCursor {
+    const ChunkedArray *col_vals;
+    int                 chunk_ndx;
+    int64_t             chunk_offset;
+
+    ColumnCursor(const ChunkedArray *src_vals, int64_t row_ndx)
+        : col_vals(src_vals), chunk_ndx(0), chunk_offset(row_ndx) {
+        // skip whole chunks until `chunk_offset` falls within one
+        while (    chunk_ndx    <  col_vals->num_chunks()
+               and chunk_offset >= col_vals->chunk(chunk_ndx)->length()) {
+            chunk_offset -= col_vals->chunk(chunk_ndx)->length();
+            chunk_ndx    += 1;
+        }
+    }
+};
+
+/**
+ * Walks `ColCount` float64 columns of equal length (and any chunking) in runs of rows
+ * that are contiguous in every column, calling `run_fn(row_start, run_vals, run_len)`.
+ */
+template<size_t ColCount, typename RunFnType>
+static void
+ForEachSharedRun(const std::array<const ChunkedArray *, ColCount> &run_cols, RunFnType &&run_fn) {
+    std::vector<ColumnCursor> col_cursors;
+    for (const auto col_vals : run_cols) { col_cursors.emplace_back(col_vals, 0); }
+
+    int64_t row_count = run_cols[0]->length();
+    for (int64_t row_ndx = 0; row_ndx < row_count; ) {
+        std::array<const double *, ColCount> run_vals;
+        int64_t                              run_len = row_count - row_ndx;
+
+        for (size_t col_ndx = 0; col_ndx < ColCount; ++col_ndx) {
+            auto &col_cursor = col_cursors[col_ndx];
+            auto  chunk_vals = static_cast<const arrow::DoubleArray *>(
+                col_cursor.col_vals->chunk(col_cursor.chunk_ndx).get()
+            );
+
+            run_vals[col_ndx] = chunk_vals->raw_values() + col_cursor.chunk_offset;
+            run_len           = std::min(run_len, chunk_vals->length() - col_cursor.chunk_offset);
+        }
+
+        run_fn(row_ndx, run_vals, run_len);
+        row_ndx += run_len;
+
+        // move every cursor past the run (and any empty chunks after it)
+        for (auto &col_cursor : col_cursors) { col_cursor = ColumnCursor(col_cursor.col_vals, row_ndx); }
+    }
+}
+
+/**
+ * Applies `new_cols` to rows [row_start, row_stop) of the state, `tile_rows` rows at a
+ * time. Within a tile, every column is applied before moving to the next tile. Each
+ * column keeps a cursor into its chunks because tiles and chunks need not line up.
+ */
+static void
+AccumulateRowRange( const std::vector<const ChunkedArray *> &new_cols
+                   ,double                                  *state_means
+                   ,double                                  *state_m2
+                   ,uint64_t                                 prior_count
+                   ,int64_t                                  row_start
+                   ,int64_t                                  row_stop
+                   ,int64_t                                  tile_rows) {
+    std::vector<ColumnCursor> col_cursors;
+    col_cursors.reserve(new_cols.size());
+    for (const auto col_vals : new_cols) {
+        col_cursors.emplace_back(col_vals, row_start);
+    }
+
+    for (int64_t tile_start = row_start; tile_start < row_stop; tile_start += tile_rows) {
+        int64_t tile_stop = std::min(tile_start + tile_rows, row_stop);
+
+        // each column is 1 more sample than the one before it
+        uint64_t col_count = prior_count;
+        for (auto &col_cursor : col_cursors) {
+            col_count += 1;
+
+            int64_t row_ndx = tile_start;
+            while (row_ndx < tile_stop) {
+                // avoid shared_ptr copies; this runs once per (tile, column, chunk)
+                auto chunk_vals = col_cursor.col_vals->chunks()[col_cursor.chunk_ndx].get();
+
+                int64_t update_len = std::min(
+                     chunk_vals->length() - col_cursor.chunk_offset
+                    ,tile_stop            - row_ndx
+                );
+
+                if (chunk_vals->type_id() == arrow::Type::FLOAT) {
+                    WelfordUpdate(
+                         static_cast<const arrow::FloatArray *>(chunk_vals)->raw_values()
+                       + col_cursor.chunk_offset
+                        ,state_means + row_ndx
+                        ,state_m2    + row_ndx
+                        ,update_len
+                        ,static_cast<double>(col_count)
+                    );
+                }
+
+                else {
+                    WelfordUpdate(
+                         static_cast<const arrow::DoubleArray *>(chunk_vals)->raw_values()
+                       + col_cursor.chunk_offset
+                        ,state_means + row_ndx
+                        ,state_m2    + row_ndx
+                        ,update_len
+                        ,static_cast<double>(col_count)
+                    );
+                }
+
+                row_ndx                 += update_len;
+                col_cursor.chunk_offset += update_len;
+                if (col_cursor.chunk_offset == chunk_vals->length()) {
+                    col_cursor.chunk_ndx    += 1;
+                    col_cursor.chunk_offset  = 0;
+                }
+            }
+        }
+    }
+}
+
+// The matrix kernel reads the sample block's raw values, so it can't skip nulls either
+static Status
+CheckMatrixBlock(shared_ptr<ChunkedArray> block_vals) {
+    for (const auto &block_chunk : block_vals->chunks()) {
+        auto list_vals = std::static_pointer_cast<arrow::FixedSizeListArray>(block_chunk);
+        if (list_vals->null_count() > 0 or list_vals->values()->null_count() > 0) {
+            return Status::Invalid("Matrix kernel does not support null values");
+        }
+    }
+
+    return Status::OK();
+}
+
+// Mean and M2 of one row's contiguous samples, in 2 passes (mean, then M2)
+template<typename ValueType>
+static void
+RowMoments(const ValueType *sample_vals, int64_t sample_count, double *mean, double *m2) {
+    double batch_sum = 0;
+    for (int64_t sample_ndx = 0; sample_ndx < sample_count; ++sample_ndx) {
+        batch_sum += static_cast<double>(sample_vals[sample_ndx]);
+    }
+
+    double batch_mean = batch_sum / static_cast<double>(sample_count);
+    double batch_m2   = 0;
+    for (int64_t sample_ndx = 0; sample_ndx < sample_count; ++sample_ndx) {
+        double delta_val  = static_cast<double>(sample_vals[sample_ndx]) - batch_mean;
+        batch_m2         += delta_val * delta_val;
+    }
+
+    *mean = batch_mean;
+    *m2   = batch_m2;
+}
+
+/**
+ * Applies samples [sample_start, sample_stop) of a matrix-layout sample block to rows
+ * [row_start, row_stop) of the state. Each row's samples are contiguous, so a row is
+ * reduced in 2 passes (see `RowMoments`) and merged into the running state with the
+ * parallel variance update used by `MeanAggr::Combine`.
+ */
+static void
+AccumulateMatrixRows( const ChunkedArray *block_vals
+                     ,int64_t             sample_start
+                     ,int64_t             sample_stop
+                     ,double             *state_means
+                     ,double             *state_m2
+                     ,uint64_t            prior_count
+                     ,int64_t             row_start
+                     ,int64_t             row_stop) {
+    double batch_count = static_cast<double>(sample_stop - sample_start);
+    double prior_size  = static_cast<double>(prior_count);
+    double total_count = prior_size + batch_count;
+
+    int64_t row_ndx = 0;
+    for (const auto &block_chunk : block_vals->chunks()) {
+        int64_t chunk_start = std::max(row_start, row_ndx);
+        int64_t chunk_stop  = std::min(row_stop , row_ndx + block_chunk->length());
+
+        auto list_vals = static_cast<const arrow::FixedSizeListArray *>(block_chunk.get());
+        auto flat_vals = list_vals->values().get();
+
+        for (int64_t state_ndx = chunk_start; state_ndx < chunk_stop; ++state_ndx) {
+            int64_t sample_offset = list_vals->value_offset(state_ndx - row_ndx) + sample_start;
+
+            double batch_mean;
+            double batch_m2;
+            if (flat_vals->type_id() == arrow::Type::FLOAT) {
+                RowMoments(
+                     static_cast<const arrow::FloatArray *>(flat_vals)->raw_values() + sample_offset
+                    ,sample_stop - sample_start
+                    ,&batch_mean
+                    ,&batch_m2
+                );
+            }
+
+            else {
+                RowMoments(
+                     static_cast<const arrow::DoubleArray *>(flat_vals)->raw_values() + sample_offset
+                    ,sample_stop - sample_start
+                    ,&batch_mean
+                    ,&batch_m2
+                );
+            }
+
+            // empty state may be uninitialized, so it is set rather than merged
+            if (prior_count == 0) {
+                state_means[state_ndx] = batch_mean;
+                state_m2[state_ndx]    = batch_m2;
+                continue;
+            }
+
+            double delta_mean       = batch_mean - state_means[state_ndx];
+            state_means[state_ndx] += delta_mean * (batch_count / total_count);
+            state_m2[state_ndx]    += (
+                  batch_m2
+                + delta_mean * delta_mean * (prior_size * batch_count / total_count)
+            );
+        }
+
+        row_ndx += block_chunk->length();
+        if (row_ndx >= row_stop) { break; }
+    }
+}
+
+/**
+ * Runs `accumulate_range(row_start, row_stop)` over `row_count` rows split into
+ * `thread_count` ranges, in parallel on the executor of `aggr_opts`. Each range only writes to
+ * its own rows of the state; ranges are multiples of 8 rows so that tasks don't share
+ * cache lines. `accumulate_range` may return a Status; the first error is returned.
+ */
+template<typename RangeFnType>
+static Status
+ForEachRowRange(int64_t row_count, const AggrOptions &aggr_opts, RangeFnType &&accumulate_range) {
+    auto RunRange = [&](int64_t range_start, int64_t range_stop) -> Status {
+        using RangeResult = std::invoke_result_t<RangeFnType &, int64_t, int64_t>;
+
+        if constexpr (std::is_void_v<RangeResult>) {
+            accumulate_range(range_start, range_stop);
+            return Status::OK();
+        }
+
+        else { return accumulate_range(range_start, range_stop); }
+    };
+
+    int64_t task_count = std::max(aggr_opts.thread_count, 1);
+    int64_t range_rows = (row_count + task_count - 1) / task_count;
+    range_rows         = std::max(((range_rows + 7) / 8) * 8, int64_t { 8 });
+    task_count         = (row_count + range_rows - 1) / range_rows;
+
+    if (task_count <= 1) { return RunRange(0, row_count); }
+
+    return arrow::internal::ParallelFor(
+         static_cast<int>(task_count)
+        ,[&](int task_ndx) {
+             int64_t range_start = task_ndx * range_rows;
+             return RunRange(range_start, std::min(range_start + range_rows, row_count));
+         }
+        ,aggr_opts.executor()
+    );
+}
+
+// Copies the values of a (possibly chunked) float64 column into a contiguous buffer
+static void
+CopyDoubles(shared_ptr<ChunkedArray> src_vals, double *dst_vals) {
+    int64_t row_offset = 0;
+
+    for (const auto &src_chunk : src_vals->chunks()) {
+        auto chunk_vals = std::static_pointer_cast<arrow::DoubleArray>(src_chunk);
+
+        std::copy(
+             chunk_vals->raw_values()
+            ,chunk_vals->raw_values() + chunk_vals->length()
+            ,dst_vals + row_offset
+        );
+
+        row_offset += chunk_vals->length();
+    }
+}
 
 
 // ------------------------------
@@ -31,7 +471,7 @@
 
 Status
 MeanAggr::PrintM1M2() {
-    auto final_vars = VecDiv(this->variances, Datum(this->count));
+    auto final_vars = VecDiv(this->variances, Datum(this->count), options.exec_ctx);
 
     std::cout << "samples aggregated: " << this->count << std::endl;
 
@@ -75,9 +515,17 @@ MeanAggr::Initialize(shared_ptr<ChunkedArray> initial_vals) {
   ARROW_RETURN_NOT_OK(init_variance.AppendEmptyValues(initial_vals->length()));
   ARROW_ASSIGN_OR_RAISE(shared_ptr<Array> variance_arr, init_variance.Finish());
 
+  // state is float64 even when values are float32
+  Datum initial_means { initial_vals };
+  if (initial_vals->type()->id() != arrow::Type::DOUBLE) {
+    ARROW_ASSIGN_OR_RAISE(initial_means, arrow::compute::Cast(
+         initial_vals, arrow::float64(), arrow::compute::CastOptions::Safe(), options.exec_ctx
+    ));
+  }
+
   // `variances` likely has different chunking from `initial_vals`
   variances   = std::make_shared<ChunkedArray>(variance_arr);
-  means       = initial_vals;
+  means       = initial_means.chunked_array();
   this->count = 1;
 
   return Status::OK();
@@ -95,36 +543,125 @@ MeanAggr::Initialize(shared_ptr<ChunkedArray> initial_vals) {
  */
 Status
 MeanAggr::Combine(const MeanAggr *other_aggr) {
-    // sum the sample sizes
-    int64_t total_count = this->count + other_aggr->count;
+    // merging with an empty aggregate is a no-op (or a copy)
+    if (other_aggr->count == 0) { return Status::OK(); }
+    if (this->count == 0) {
+        this->count     = other_aggr->count;
+        this->means     = other_aggr->means;
+        this->variances = other_aggr->variances;
 
-    std::cout << "Dimensions of [A]:" << std::endl
-              << "\tmeans: "     << this->means->length()     << std::endl
-              << "\tvariances: " << this->variances->length() << std::endl
-    ;
+        // state that `other_aggr` updates in place is copied, so that it can't change ours
+        if (other_aggr->OwnsState()) { return PrepareMutableState(this->means->length()); }
 
-    std::cout << "Dimensions of [B]:" << std::endl
-              << "\tmeans: "     << other_aggr->means->length()     << std::endl
-              << "\tvariances: " << other_aggr->variances->length() << std::endl
-    ;
+        return Status::OK();
+    }
+
+    if (this->means->length() != other_aggr->means->length()) {
+        return Status::Invalid(
+             "Cannot combine aggregates of different lengths: "
+            ,this->means->length(), " and ", other_aggr->means->length()
+        );
+    }
+
+    // nulls (and non-float64 state) are only handled by the reference path
+    bool is_fusable = (options.kernel != AggrKernel::Vec);
+    for (const auto &state_vals : { this->means, this->variances, other_aggr->means, other_aggr->variances }) {
+        is_fusable = (
+                is_fusable
+            and state_vals->type()->id() == arrow::Type::DOUBLE
+            and state_vals->null_count() == 0
+        );
+    }
+
+    if (is_fusable) { return this->CombineFused(other_aggr); }
+    return this->CombineVec(other_aggr);
+}
+
+// Reference merge: 1 arrow compute call (and 1 new array) per term
+Status
+MeanAggr::CombineVec(const MeanAggr *other_aggr) {
+    #if DEBUG != 0
+        std::cout << "Dimensions of [A]:" << std::endl
+                  << "\tmeans: "     << this->means->length()     << std::endl
+                  << "\tvariances: " << this->variances->length() << std::endl
+        ;
+
+        std::cout << "Dimensions of [B]:" << std::endl
+                  << "\tmeans: "     << other_aggr->means->length()     << std::endl
+                  << "\tvariances: " << other_aggr->variances->length() << std::endl
+        ;
+    #endif
+
+    // sum the sample sizes
+    uint64_t total_count = this->count + other_aggr->count;
+
+    // >> Recurrent term for M2; delta uses the means from *before* they are merged
+    auto   exec_ctx      = options.exec_ctx;
+    auto   delta_mean    = VecSub(other_aggr->means, this->means, exec_ctx);
+    auto   squared_delta = VecMul(delta_mean       , delta_mean , exec_ctx);
+    double co_samplesize = (
+          (static_cast<double>(this->count) * static_cast<double>(other_aggr->count))
+        / static_cast<double>(total_count)
+    );
+    auto   co_variance   = VecMul(squared_delta, Datum(co_samplesize), exec_ctx);
 
     // >> update mean
-    auto this_sum  = VecMul(this->means      , Datum(this->count      ));
-    auto other_sum = VecMul(other_aggr->means, Datum(other_aggr->count));
-    auto new_means = VecDiv(VecAdd(this_sum, other_sum), Datum(total_count));
-    this->means    = new_means;
-
-    // >> update M2
-    // Recurrent term
-    auto delta_mean    = VecSub(other_aggr->means, this->means);
-    auto squared_delta = VecMul(delta_mean       , delta_mean );
-    auto co_samplesize = (this->count * other_aggr->count) / total_count;
-    auto co_variance   = VecMul(squared_delta, Datum(co_samplesize));
-
-    // M2,a + M2,b + recurrent term
-    auto combined_vars = VecAdd(this->variances, other_aggr->variances);
-    auto new_variance  = VecAdd(combined_vars  , co_variance          );
-    this->variances    = new_variance;
+    auto this_sum  = VecMul(this->means      , Datum(this->count      ), exec_ctx);
+    auto other_sum = VecMul(other_aggr->means, Datum(other_aggr->count), exec_ctx);
+    auto new_means = VecDiv(VecAdd(this_sum, other_sum, exec_ctx), Datum(total_count), exec_ctx);
+
+    // >> update M2: M2,a + M2,b + recurrent term
+    auto combined_vars = VecAdd(this->variances, other_aggr->variances, exec_ctx);
+    auto new_variance  = VecAdd(combined_vars  , co_variance          , exec_ctx);
+
+    if (new_means == nullptr or new_variance == nullptr) {
+        return Status::Invalid("Failed to combine aggregates");
+    }
+
+    this->means     = new_means;
+    this->variances = new_variance;
+    this->count     = total_count;
+
+    return Status::OK();
+}
+
+/**
+ * Fused merge: the same terms as `CombineVec`, in the same order, but each row's mean and
+ * M2 are updated in place in 1 pass. State that this aggregate doesn't own (e.g. that it
+ * took from another aggregate) is copied once, first.
+ */
+Status
+MeanAggr::CombineFused(const MeanAggr *other_aggr) {
+    ARROW_RETURN_NOT_OK(PrepareMutableState(this->means->length()));
+
+    double this_size     = static_cast<double>(this->count);
+    double other_size    = static_cast<double>(other_aggr->count);
+    double total_size    = static_cast<double>(this->count + other_aggr->count);
+    double co_samplesize = (this_size * other_size) / total_size;
+
+    double *state_means = reinterpret_cast<double *>(means_buffer->mutable_data());
+    double *state_m2    = reinterpret_cast<double *>(variances_buffer->mutable_data());
+
+    ForEachSharedRun<2>(
+         { other_aggr->means.get(), other_aggr->variances.get() }
+        ,[&](int64_t row_start, const std::array<const double *, 2> &run_vals, int64_t run_len) {
+             const double *other_means = run_vals[0];
+             const double *other_m2    = run_vals[1];
+
+             for (int64_t run_ndx = 0; run_ndx < run_len; ++run_ndx) {
+                 double &row_mean   = state_means[row_start + run_ndx];
+                 double  delta_mean = other_means[run_ndx] - row_mean;
+
+                 row_mean = ((row_mean * this_size) + (other_means[run_ndx] * other_size)) / total_size;
+                 state_m2[row_start + run_ndx] = (
+                       (state_m2[row_start + run_ndx] + other_m2[run_ndx])
+                     + ((delta_mean * delta_mean) * co_samplesize)
+                 );
+             }
+         }
+    );
+
+    this->count += other_aggr->count;
 
     return Status::OK();
 }
@@ -148,6 +685,41 @@ Status
 MeanAggr::Accumulate( shared_ptr<Table> new_vals
                      ,int64_t           col_startndx
                      ,int64_t           col_stopndx) {
+    // if stop ndx is 0, then default to the last column
+    if (col_stopndx == 0) { col_stopndx = AggrColumnCount(new_vals); }
+
+    if (this->options.col_partitions > 1) {
+        return this->AccumulatePartitioned(new_vals, col_startndx, col_stopndx);
+    }
+
+    // samples of the matrix layout are not columns, so it has its own kernel
+    if (IsMatrixLayout(*new_vals->schema())) {
+        ARROW_RETURN_NOT_OK(CheckLayoutKernel(*new_vals->schema(), this->options.kernel));
+        return this->AccumulateMatrix(new_vals, col_startndx, col_stopndx);
+    }
+
+    switch (this->options.kernel) {
+        case AggrKernel::Vec:
+            return this->AccumulateVec(new_vals, col_startndx, col_stopndx);
+
+        case AggrKernel::Fused:
+            return this->AccumulateFused(new_vals, col_startndx, col_stopndx);
+
+        case AggrKernel::Tiled:
+            return this->AccumulateTiled(new_vals, col_startndx, col_stopndx);
+
+        case AggrKernel::Arrow:
+            return this->AccumulateArrow(new_vals, col_startndx, col_stopndx);
+    }
+
+    return Status::Invalid("Unknown aggregation kernel");
+}
+
+Status
+MeanAggr::AccumulateVec( shared_ptr<Table> new_vals
+                        ,int64_t           col_startndx
+                        ,int64_t           col_stopndx) {
+    auto                     exec_ctx = options.exec_ctx;
     shared_ptr<ChunkedArray> delta_mean;
     shared_ptr<ChunkedArray> delta_var;
 
@@ -157,27 +729,378 @@ MeanAggr::Accumulate( shared_ptr<Table> new_vals
         col_startndx += 1;
     }
 
-    // if stop ndx is 0, then default to the last column
-    if (col_stopndx == 0) { col_stopndx = new_vals->num_columns(); }
-
     for (; col_startndx < col_stopndx; ++col_startndx) {
         // use a result just to make call chains easier
         auto col_vals = new_vals->column(col_startndx);
 
         this->count += 1;
-        delta_mean  = VecSub(col_vals, this->means);
+        delta_mean  = VecSub(col_vals, this->means, exec_ctx);
         this->means = VecAdd(
              this->means
-            ,VecDiv(delta_mean, Datum(this->count))
+            ,VecDiv(delta_mean, Datum(this->count), exec_ctx)
+            ,exec_ctx
         );
 
-        delta_var       = VecSub(col_vals, this->means);
+        delta_var       = VecSub(col_vals, this->means, exec_ctx);
         this->variances = VecAdd(
              this->variances
-            ,VecMul(delta_var, delta_mean)
+            ,VecMul(delta_var, delta_mean, exec_ctx)
+            ,exec_ctx
+        );
+    }
+
+    return Status::OK();
+}
+
+/**
+ * Same recurrence as `AccumulateVec`, but `means` and `variances` are updated in place.
+ * When the state is empty, it starts as zeros: the first column then yields
+ * mean = value and M2 = 0, which is what `Initialize` would have set.
+ */
+Status
+MeanAggr::AccumulateFused( shared_ptr<Table> new_vals
+                          ,int64_t           col_startndx
+                          ,int64_t           col_stopndx) {
+    // a single tile spanning every row: apply each column to all rows, one at a time
+    return this->AccumulateInPlace(
+        new_vals, col_startndx, col_stopndx, std::max(new_vals->num_rows(), int64_t { 1 })
+    );
+}
+
+/**
+ * Same update as `AccumulateFused`, with the loops swapped at the granularity of a tile:
+ * for each block of `options.tile_rows` rows, every column is applied before moving on.
+ * The mean and M2 values for a tile stay in cache across all columns, instead of being
+ * streamed from memory once per column.
+ */
+Status
+MeanAggr::AccumulateTiled( shared_ptr<Table> new_vals
+                          ,int64_t           col_startndx
+                          ,int64_t           col_stopndx) {
+    if (this->options.tile_rows <= 0) {
+        return Status::Invalid("Tile size must be positive: ", this->options.tile_rows);
+    }
+
+    return this->AccumulateInPlace(
+        new_vals, col_startndx, col_stopndx, this->options.tile_rows
+    );
+}
+
+/**
+ * Shared driver for the fused and tiled kernels. Rows are independent, so when
+ * `options.thread_count` > 1 the rows are split into that many ranges and each range is
+ * accumulated by a task on the options' executor (see `ForEachRowRange`).
+ */
+Status
+MeanAggr::AccumulateInPlace( shared_ptr<Table> new_vals
+                            ,int64_t           col_startndx
+                            ,int64_t           col_stopndx
+                            ,int64_t           tile_rows) {
+    int64_t row_count = new_vals->num_rows();
+    ARROW_RETURN_NOT_OK(this->PrepareMutableState(row_count));
+
+    double *state_means = reinterpret_cast<double *>(means_buffer->mutable_data());
+    double *state_m2    = reinterpret_cast<double *>(variances_buffer->mutable_data());
+
+    std::vector<const ChunkedArray *> new_cols;
+    new_cols.reserve(std::max(col_stopndx - col_startndx, int64_t { 0 }));
+    for (int64_t col_ndx = col_startndx; col_ndx < col_stopndx; ++col_ndx) {
+        ARROW_RETURN_NOT_OK(CheckFusedColumn(new_vals->column(col_ndx), col_ndx));
+        new_cols.push_back(new_vals->column(col_ndx).get());
+    }
+
+    uint64_t prior_count = this->count;
+    ARROW_RETURN_NOT_OK(ForEachRowRange(
+         row_count
+        ,this->options
+        ,[&](int64_t range_start, int64_t range_stop) {
+             AccumulateRowRange(
+                  new_cols
+                 ,state_means
+                 ,state_m2
+                 ,prior_count
+                 ,range_start
+                 ,range_stop
+                 ,tile_rows
+             );
+         }
+    ));
+
+    this->count += new_cols.size();
+
+    return Status::OK();
+}
+
+/**
+ * Kernel for the matrix layout, where columns [col_startndx, col_stopndx) are samples
+ * [col_startndx - 1, col_stopndx - 1) of the sample block. Rows are split into ranges
+ * across `options.thread_count` tasks, as for the fused kernel, but each task walks rows
+ * rather than columns: per row, the samples are one contiguous run of doubles.
+ */
+Status
+MeanAggr::AccumulateMatrix( shared_ptr<Table> new_vals
+                           ,int64_t           col_startndx
+                           ,int64_t           col_stopndx) {
+    int64_t col_count = col_stopndx - col_startndx;
+    if (col_count <= 0) { return Status::OK(); }
+
+    if (col_startndx < 1 or col_stopndx > AggrColumnCount(new_vals)) {
+        return Status::IndexError(
+            "Sample columns [", col_startndx, ", ", col_stopndx, ") are out of range"
         );
     }
 
+    auto block_vals = new_vals->column(1);
+    ARROW_RETURN_NOT_OK(CheckMatrixBlock(block_vals));
+
+    int64_t row_count = new_vals->num_rows();
+    ARROW_RETURN_NOT_OK(this->PrepareMutableState(row_count));
+
+    double *state_means = reinterpret_cast<double *>(means_buffer->mutable_data());
+    double *state_m2    = reinterpret_cast<double *>(variances_buffer->mutable_data());
+
+    uint64_t prior_count = this->count;
+    ARROW_RETURN_NOT_OK(ForEachRowRange(
+         row_count
+        ,this->options
+        ,[&](int64_t range_start, int64_t range_stop) {
+             AccumulateMatrixRows(
+                  block_vals.get()
+                 ,col_startndx - 1
+                 ,col_stopndx  - 1
+                 ,state_means
+                 ,state_m2
+                 ,prior_count
+                 ,range_start
+                 ,range_stop
+             );
+         }
+    ));
+
+    this->count += col_count;
+
+    return Status::OK();
+}
+
+/**
+ * Lets arrow drive the aggregation: the registered "welford_rows" function (see
+ * kernels_arrow.hpp) reads the column batch as is and returns each row's Welford state, so
+ * arrow's executor aligns column chunks and dispatches the kernel. Rows are split into
+ * `thread_count` ranges, as for the fused kernel; each range calls the function on zero-copy
+ * slices of the columns and writes its rows of the new state. The new state is then merged
+ * into this aggregate.
+ */
+Status
+MeanAggr::AccumulateArrow( shared_ptr<Table> new_vals
+                          ,int64_t           col_startndx
+                          ,int64_t           col_stopndx) {
+    ARROW_RETURN_NOT_OK(RegisterWelfordFunctions());
+
+    int64_t row_count = new_vals->num_rows();
+    int64_t col_count = col_stopndx - col_startndx;
+    if (col_count <= 0) { return Status::OK(); }
+
+    // every column is an argument of 1 call, so they must share a type
+    auto value_type = new_vals->schema()->field(col_startndx)->type();
+    for (int64_t col_ndx = col_startndx; col_ndx < col_stopndx; ++col_ndx) {
+        auto col_type = new_vals->schema()->field(col_ndx)->type();
+        if (not IsSampleType(*col_type) or not col_type->Equals(value_type)) {
+            return Status::TypeError(
+                "Arrow kernel expects float32 or float64 columns of 1 type; column ", col_ndx
+               ," is ", col_type->ToString()
+            );
+        }
+    }
+
+    int64_t buffer_size = row_count * static_cast<int64_t>(sizeof(double));
+    MemoryPool *state_pool = options.memory_pool();
+    ARROW_ASSIGN_OR_RAISE(shared_ptr<Buffer> new_means, arrow::AllocateBuffer(buffer_size, state_pool));
+    ARROW_ASSIGN_OR_RAISE(shared_ptr<Buffer> new_vars , arrow::AllocateBuffer(buffer_size, state_pool));
+
+    double *new_means_data = reinterpret_cast<double *>(new_means->mutable_data());
+    double *new_vars_data  = reinterpret_cast<double *>(new_vars->mutable_data());
+
+    ARROW_RETURN_NOT_OK(ForEachRowRange(
+         row_count
+        ,this->options
+        ,[&](int64_t range_start, int64_t range_stop) -> Status {
+             int64_t range_rows = range_stop - range_start;
+
+             std::vector<Datum> range_cols;
+             range_cols.reserve(col_count);
+             for (int64_t col_ndx = col_startndx; col_ndx < col_stopndx; ++col_ndx) {
+                 range_cols.emplace_back(new_vals->column(col_ndx)->Slice(range_start, range_rows));
+             }
+
+             ARROW_ASSIGN_OR_RAISE(
+                  auto range_states
+                 ,arrow::compute::CallFunction("welford_rows", range_cols, options.exec_ctx)
+             );
+
+             ArrayVector state_chunks = (
+                   range_states.is_array()
+                 ? ArrayVector { range_states.make_array() }
+                 : range_states.chunks()
+             );
+
+             int64_t row_ndx = range_start;
+             for (const auto &state_chunk : state_chunks) {
+                 auto state_arr  = std::static_pointer_cast<arrow::StructArray>(state_chunk);
+                 auto count_vals = std::static_pointer_cast<arrow::UInt64Array>(state_arr->field(0));
+                 auto mean_vals  = std::static_pointer_cast<arrow::DoubleArray>(state_arr->field(1));
+                 auto m2_vals    = std::static_pointer_cast<arrow::DoubleArray>(state_arr->field(2));
+
+                 // MeanAggr keeps 1 count for all rows, so every row must have seen every column
+                 for (int64_t chunk_ndx = 0; chunk_ndx < state_arr->length(); ++chunk_ndx) {
+                     if (count_vals->Value(chunk_ndx) != static_cast<uint64_t>(col_count)) {
+                         return Status::Invalid("Arrow kernel does not support null values");
+                     }
+
+                     new_means_data[row_ndx] = mean_vals->Value(chunk_ndx);
+                     new_vars_data[row_ndx]  = m2_vals->Value(chunk_ndx);
+                     ++row_ndx;
+                 }
+             }
+
+             if (row_ndx != range_stop) {
+                 return Status::Invalid("Expected ", range_rows, " row states; got ", row_ndx - range_start);
+             }
+
+             return Status::OK();
+         }
+    ));
+
+    MeanAggr new_aggr;
+    new_aggr.count     = static_cast<uint64_t>(col_count);
+    new_aggr.means     = std::make_shared<ChunkedArray>(
+        std::make_shared<arrow::DoubleArray>(row_count, new_means)
+    );
+    new_aggr.variances = std::make_shared<ChunkedArray>(
+        std::make_shared<arrow::DoubleArray>(row_count, new_vars)
+    );
+
+    return this->Combine(&new_aggr);
+}
+
+/**
+ * Splits columns [col_startndx, col_stopndx) into `options.col_partitions` disjoint ranges
+ * and accumulates each range into its own aggregate, in parallel on arrow's CPU thread
+ * pool. This mirrors how skytether computes partial aggregates over disjoint sample sets.
+ * The partial aggregates are then merged pairwise in a balanced tree (log2(K) rounds of
+ * `Combine`, each round in parallel) and the root is merged into this aggregate.
+ */
+Status
+MeanAggr::AccumulatePartitioned( shared_ptr<Table> new_vals
+                                ,int64_t           col_startndx
+                                ,int64_t           col_stopndx) {
+    int64_t col_count = col_stopndx - col_startndx;
+    if (col_count <= 0) { return Status::OK(); }
+
+    // parallelism comes from the partitions, so each one runs its kernel on 1 thread
+    AggrOptions part_opts    = this->options;
+    part_opts.col_partitions = 1;
+    part_opts.thread_count   = 1;
+
+    int64_t part_count = std::min(static_cast<int64_t>(this->options.col_partitions), col_count);
+    std::vector<MeanAggr> part_aggrs(part_count, MeanAggr { part_opts });
+
+    // >> accumulate each column range; the first (col_count % part_count) get 1 extra
+    ARROW_RETURN_NOT_OK(arrow::internal::ParallelFor(
+         static_cast<int>(part_count)
+        ,[&](int part_ndx) {
+             int64_t part_size  = col_count / part_count;
+             int64_t part_extra = col_count % part_count;
+             int64_t part_start = (
+                   col_startndx
+                 + part_ndx * part_size
+                 + std::min(static_cast<int64_t>(part_ndx), part_extra)
+             );
+             int64_t part_stop  = part_start + part_size + (part_ndx < part_extra ? 1 : 0);
+
+             return part_aggrs[part_ndx].Accumulate(new_vals, part_start, part_stop);
+         }
+        ,this->options.executor()
+    ));
+
+    // >> balanced tree merge: in each round, aggr[i] absorbs aggr[i + stride]
+    for (int64_t stride = 1; stride < part_count; stride *= 2) {
+        int64_t merge_count = (part_count - stride + (2 * stride) - 1) / (2 * stride);
+
+        ARROW_RETURN_NOT_OK(arrow::internal::ParallelFor(
+             static_cast<int>(merge_count)
+            ,[&](int merge_ndx) {
+                 int64_t left_ndx = merge_ndx * 2 * stride;
+                 return part_aggrs[left_ndx].Combine(&part_aggrs[left_ndx + stride]);
+             }
+            ,this->options.executor()
+        ));
+    }
+
+    return this->Combine(&part_aggrs[0]);
+}
+
+/**
+ * The fused kernel may only write to buffers it allocated itself. If `means` or
+ * `variances` were replaced (e.g. by `Combine` or by a caller), they are no longer
+ * backed by our buffers.
+ */
+bool
+MeanAggr::OwnsState() const {
+    if (means_buffer == nullptr or variances_buffer == nullptr) { return false; }
+    if (means == nullptr or variances == nullptr)               { return false; }
+    if (means->num_chunks() != 1 or variances->num_chunks() != 1) { return false; }
+
+    auto means_data = means->chunk(0)->data();
+    auto vars_data  = variances->chunk(0)->data();
+
+    return (
+            means_data->offset == 0 and means_data->buffers[1] == means_buffer
+        and vars_data->offset  == 0 and vars_data->buffers[1]  == variances_buffer
+    );
+}
+
+/**
+ * Make sure `means` and `variances` are backed by contiguous, mutable buffers that this
+ * aggregate owns. Existing state is copied (once); empty state is zero-filled.
+ */
+Status
+MeanAggr::PrepareMutableState(int64_t row_count) {
+    if (this->count > 0 and this->means->length() != row_count) {
+        return Status::Invalid(
+            "Aggregate has ", this->means->length(), " rows; new values have ", row_count
+        );
+    }
+
+    if (this->OwnsState()) { return Status::OK(); }
+
+    int64_t buffer_size = row_count * static_cast<int64_t>(sizeof(double));
+    MemoryPool *state_pool = options.memory_pool();
+    ARROW_ASSIGN_OR_RAISE(shared_ptr<Buffer> new_means, arrow::AllocateBuffer(buffer_size, state_pool));
+    ARROW_ASSIGN_OR_RAISE(shared_ptr<Buffer> new_vars , arrow::AllocateBuffer(buffer_size, state_pool));
+
+    double *new_means_data = reinterpret_cast<double *>(new_means->mutable_data());
+    double *new_vars_data  = reinterpret_cast<double *>(new_vars->mutable_data());
+
+    if (this->count == 0) {
+        std::fill(new_means_data, new_means_data + row_count, 0.0);
+        std::fill(new_vars_data , new_vars_data  + row_count, 0.0);
+    }
+
+    else {
+        CopyDoubles(this->means    , new_means_data);
+        CopyDoubles(this->variances, new_vars_data );
+    }
+
+    means_buffer     = new_means;
+    variances_buffer = new_vars;
+
+    this->means     = std::make_shared<ChunkedArray>(
+        std::make_shared<arrow::DoubleArray>(row_count, new_means)
+    );
+    this->variances = std::make_shared<ChunkedArray>(
+        std::make_shared<arrow::DoubleArray>(row_count, new_vars)
+    );
+
     return Status::OK();
 }
 
@@ -188,55 +1111,578 @@ MeanAggr::TakeResult() {
        ,arrow::field("variance", arrow::float64())
   });
 
+  // The result shares our buffers; give them up so that later updates don't modify it
+  means_buffer.reset();
+  variances_buffer.reset();
+
   return Table::Make(result_schema, { this->means, this->variances });
 }
 
+/**
+ * The state, as is (no copies), next to the key of each row. Unlike `TakeResult`, the
+ * aggregate keeps its buffers, so it must not be updated while the table is in use.
+ */
+Result<shared_ptr<Table>>
+MeanAggr::StateTable(shared_ptr<Field> key_field, shared_ptr<ChunkedArray> row_keys) const {
+    if (this->count == 0) { return Status::Invalid("Cannot serialize an empty aggregate"); }
+
+    if (row_keys->length() != this->means->length()) {
+        return Status::Invalid(
+            "Aggregate has ", this->means->length(), " rows; got ", row_keys->length(), " keys"
+        );
+    }
+
+    auto state_meta = std::make_shared<KVMetadata>();
+    state_meta->Append(aggr_count_key, std::to_string(this->count));
+
+    auto state_schema = arrow::schema(
+         {
+              key_field->WithType(row_keys->type())
+             ,arrow::field("mean"    , this->means->type())
+             ,arrow::field("variance", this->variances->type())
+         }
+        ,state_meta
+    );
+
+    return Table::Make(state_schema, { row_keys, this->means, this->variances });
+}
+
+// IPC stream bytes of `StateTable`; state buffers are written uncompressed, so they can be
+// read in place
+Result<shared_ptr<Buffer>>
+MeanAggr::Serialize(shared_ptr<Field> key_field, shared_ptr<ChunkedArray> row_keys) const {
+    ARROW_ASSIGN_OR_RAISE(auto state_table, StateTable(std::move(key_field), std::move(row_keys)));
+    return WriteTableToBuffer(state_table);
+}
+
+Result<MeanAggr>
+MeanAggr::FromStateTable( shared_ptr<Table>         state_table
+                         ,shared_ptr<ChunkedArray> *row_keys
+                         ,AggrOptions               aggr_opts) {
+    if (state_table->num_columns() != 3) {
+        return Status::Invalid(
+            "Expected aggregate state (key, mean, variance); got ", state_table->num_columns(), " columns"
+        );
+    }
+
+    for (int col_ndx : { 1, 2 }) {
+        if (state_table->column(col_ndx)->type()->id() != arrow::Type::DOUBLE) {
+            return Status::TypeError(
+                 "Aggregate state column [", state_table->schema()->field(col_ndx)->name()
+                ,"] is ", state_table->column(col_ndx)->type()->ToString(), "; expected double"
+            );
+        }
+    }
+
+    MeanAggr state_aggr { aggr_opts };
+    ARROW_ASSIGN_OR_RAISE(state_aggr.count, GetAggrCount(state_table->schema()->metadata()));
+    state_aggr.means     = state_table->column(1);
+    state_aggr.variances = state_table->column(2);
+
+    if (row_keys != nullptr) { *row_keys = state_table->column(0); }
+
+    return state_aggr;
+}
+
+// Decoding an IPC stream from memory slices `state_buffer`; the state isn't copied
+Result<MeanAggr>
+MeanAggr::Deserialize( shared_ptr<Buffer>         state_buffer
+                      ,shared_ptr<ChunkedArray> *row_keys
+                      ,AggrOptions               aggr_opts) {
+    ARROW_ASSIGN_OR_RAISE(auto state_table, ReadTableFromBuffer(std::move(state_buffer)));
+    return FromStateTable(state_table, row_keys, aggr_opts);
+}
+
+Result<MeanAggr>
+MeanAggr::DeserializeFile( const std::string         &path_as_uri
+                          ,shared_ptr<ChunkedArray>  *row_keys
+                          ,IOStrategy                 io_strategy
+                          ,AggrOptions                aggr_opts) {
+    ARROW_ASSIGN_OR_RAISE(auto state_file  , OpenIPCInput(path_as_uri, io_strategy));
+    ARROW_ASSIGN_OR_RAISE(auto state_size  , state_file->GetSize());
+    ARROW_ASSIGN_OR_RAISE(auto state_buffer, state_file->ReadAt(0, state_size));
+
+    return Deserialize(state_buffer, row_keys, aggr_opts);
+}
+
 shared_ptr<Table>
 MeanAggr::ComputeTStatWith(const MeanAggr &other_aggr) {
+    // rows must be aligned (1 per gene, in 1 order); a mismatch is the caller's to fix
+    for (const auto &state_vals : { this->variances, other_aggr.means, other_aggr.variances }) {
+        if (state_vals->length() != this->means->length()) { return nullptr; }
+    }
+
+    if (options.kernel == AggrKernel::Vec) { return this->ComputeTStatVec(other_aggr); }
+
+    int64_t row_count   = this->means->length();
+    auto    tstat_alloc = arrow::AllocateBuffer(
+        row_count * static_cast<int64_t>(sizeof(double)), options.memory_pool()
+    );
+    if (not tstat_alloc.ok()) { return nullptr; }
+
+    shared_ptr<Buffer> tstat_buffer = std::move(*tstat_alloc);
+    auto tstat_status = ComputeTStatInto(
+        other_aggr, reinterpret_cast<double *>(tstat_buffer->mutable_data())
+    );
+
+    // state the fused kernel can't read (float32 or with nulls) goes through the reference
+    // path; lengths were checked above, so they are not why it failed
+    if (not tstat_status.ok()) { return this->ComputeTStatVec(other_aggr); }
+
+    return Table::Make(
+         arrow::schema({ arrow::field("t-statistic", arrow::float64()) })
+        ,{ std::make_shared<ChunkedArray>(std::make_shared<arrow::DoubleArray>(row_count, tstat_buffer)) }
+    );
+}
+
+/**
+ * Fused t-statistic: the terms of `ComputeTStatVec` that only depend on the sample sizes
+ * are folded into constants, so each row is 1 pass over both means and variances, with a
+ * sqrt (instead of a power of 0.5) and 1 division.
+ */
+Status
+MeanAggr::ComputeTStatInto(const MeanAggr &other_aggr, double *tstat_vals) const {
+    for (const auto &state_vals : { this->means, this->variances, other_aggr.means, other_aggr.variances }) {
+        if (state_vals->type()->id() != arrow::Type::DOUBLE or state_vals->null_count() > 0) {
+            return Status::Invalid("Fused t-statistic expects float64 state without nulls");
+        }
+
+        if (state_vals->length() != this->means->length()) {
+            return Status::Invalid(
+                "Aggregates have different lengths: ", this->means->length(), " and ", state_vals->length()
+            );
+        }
+    }
+
+    double left_size    = static_cast<double>(this->count);
+    double right_size   = static_cast<double>(other_aggr.count);
+    double left_factor  = (left_size  - 1) / left_size;
+    double right_factor = (right_size - 1) / right_size;
+    double pooled_dof   = left_size + right_size - 2;
+    double scale_factor = std::sqrt((1.0 / left_size) + (1.0 / right_size));
+
+    ForEachSharedRun<4>(
+         { this->means.get(), other_aggr.means.get(), this->variances.get(), other_aggr.variances.get() }
+        ,[&](int64_t row_start, const std::array<const double *, 4> &run_vals, int64_t run_len) {
+             const double *left_means  = run_vals[0];
+             const double *right_means = run_vals[1];
+             const double *left_vars   = run_vals[2];
+             const double *right_vars  = run_vals[3];
+             double       *run_tstats  = tstat_vals + row_start;
+
+             for (int64_t run_ndx = 0; run_ndx < run_len; ++run_ndx) {
+                 double pooled_var = (
+                       ((left_vars[run_ndx] * left_factor) + (right_vars[run_ndx] * right_factor))
+                     / pooled_dof
+                 );
+
+                 run_tstats[run_ndx] = (
+                       (left_means[run_ndx] - right_means[run_ndx])
+                     / (std::sqrt(pooled_var) * scale_factor)
+                 );
+             }
+         }
+    );
+
+    return Status::OK();
+}
+
+// Reference t-statistic: 1 arrow compute call (and 1 new array) per term
+shared_ptr<Table>
+MeanAggr::ComputeTStatVec(const MeanAggr &other_aggr) {
     auto left_size  =  this->count;
     auto right_size = other_aggr.count;
 
-    auto  left_vars = VecDiv(this->variances     , Datum(left_size) );
-    auto right_vars = VecDiv(other_aggr.variances, Datum(right_size));
+    auto exec_ctx   = options.exec_ctx;
+
+    auto  left_vars = VecDiv(this->variances     , Datum(left_size) , exec_ctx);
+    auto right_vars = VecDiv(other_aggr.variances, Datum(right_size), exec_ctx);
 
     // Subtract means; numerator
-    auto ttest_num = VecSub(this->means, other_aggr.means);
+    auto ttest_num = VecSub(this->means, other_aggr.means, exec_ctx);
 
     // square root of scaling factor (sample sizes); right side of denom
     double scale_factor = std::sqrt((1.0 / left_size) + (1.0 / right_size));
 
     // And now the "complex" variance calculations
     auto ttest_denom = VecAdd(
-         VecMul(left_vars , Datum( left_size - 1))
-        ,VecMul(right_vars, Datum(right_size - 1))
+         VecMul(left_vars , Datum( left_size - 1), exec_ctx)
+        ,VecMul(right_vars, Datum(right_size - 1), exec_ctx)
+        ,exec_ctx
     );
 
-    ttest_denom = VecDiv(ttest_denom, Datum((left_size + right_size - 2)));
-    ttest_denom = VecPow(ttest_denom, Datum(0.5));
-    ttest_denom = VecMul(ttest_denom, Datum(scale_factor));
+    ttest_denom = VecDiv(ttest_denom, Datum((left_size + right_size - 2)), exec_ctx);
+    ttest_denom = VecPow(ttest_denom, Datum(0.5), exec_ctx);
+    ttest_denom = VecMul(ttest_denom, Datum(scale_factor), exec_ctx);
+
+    if (ttest_num == nullptr or ttest_denom == nullptr) { return nullptr; }
+
+    auto ttest_vals = VecDiv(ttest_num, ttest_denom, exec_ctx);
+    if (ttest_vals == nullptr) { return nullptr; }
 
     return Table::Make(
          arrow::schema({ arrow::field("t-statistic", arrow::float64()) })
-        ,{ VecDiv(ttest_num, ttest_denom) }
+        ,{ ttest_vals }
     );
 }
 
 
+// >> SliceAggr implementation
+
+SliceAggr::SliceAggr(AggrOptions aggr_opts, int64_t total_rows)
+    : options(aggr_opts), row_count(total_rows), next_rowndx(0) {
+    int64_t buffer_size = row_count * static_cast<int64_t>(sizeof(double));
+
+    auto means_result = arrow::AllocateBuffer(buffer_size, options.memory_pool());
+    auto vars_result  = arrow::AllocateBuffer(buffer_size, options.memory_pool());
+    if (not means_result.ok()) { slice_status = means_result.status(); return; }
+    if (not vars_result.ok() ) { slice_status = vars_result.status();  return; }
+
+    means_buffer     = std::move(means_result).ValueOrDie();
+    variances_buffer = std::move(vars_result).ValueOrDie();
+}
+
+/**
+ * Accumulate one slice into the next rows of the result, and return the time it took.
+ * Errors are sticky: once a slice fails, later slices are skipped and `status()` reports
+ * the first error.
+ */
+std::chrono::nanoseconds
+SliceAggr::AggrSlice(shared_ptr<Table> slice_table, int64_t col_startndx, int64_t col_limit) {
+  if (not slice_status.ok()) { return std::chrono::nanoseconds { 0 }; }
+
+  int64_t col_stopndx = AggrColumnStop(slice_table, col_startndx, col_limit);
+
+  auto aggr_tstart = std::chrono::steady_clock::now();
+  slice_status     = this->AccumulateSlice(slice_table, col_startndx, col_stopndx);
+  auto aggr_tstop  = std::chrono::steady_clock::now();
+
+  if (not slice_status.ok()) {
+    std::cerr << "Error during aggregation: "
+              << slice_status.message()
+              << std::endl;
+  }
+
+  return aggr_tstop - aggr_tstart;
+}
+
+Status
+SliceAggr::AccumulateSlice( shared_ptr<Table> slice_table
+                           ,int64_t           col_startndx
+                           ,int64_t           col_stopndx) {
+    int64_t slice_rows = slice_table->num_rows();
+    if (next_rowndx + slice_rows > row_count) {
+        return Status::Invalid(
+            "Slice rows exceed table rows: ", next_rowndx + slice_rows, " > ", row_count
+        );
+    }
+
+    double *slice_means = reinterpret_cast<double *>(means_buffer->mutable_data()) + next_rowndx;
+    double *slice_m2    = reinterpret_cast<double *>(variances_buffer->mutable_data()) + next_rowndx;
+
+    // >> matrix layout: every kernel reduces each row's contiguous samples directly
+    if (IsMatrixLayout(*slice_table->schema())) {
+        ARROW_RETURN_NOT_OK(CheckLayoutKernel(*slice_table->schema(), options.kernel));
+        if (col_startndx < 1 or col_stopndx <= col_startndx) {
+            return Status::Invalid("Slice has no columns to aggregate");
+        }
+
+        auto block_vals = slice_table->column(1);
+        ARROW_RETURN_NOT_OK(CheckMatrixBlock(block_vals));
+
+        ARROW_RETURN_NOT_OK(ForEachRowRange(
+             slice_rows
+            ,options
+            ,[&](int64_t range_start, int64_t range_stop) {
+                 AccumulateMatrixRows(
+                      block_vals.get()
+                     ,col_startndx - 1
+                     ,col_stopndx  - 1
+                     ,slice_means
+                     ,slice_m2
+                     ,0
+                     ,range_start
+                     ,range_stop
+                 );
+             }
+        ));
+
+        next_rowndx += slice_rows;
+        return Status::OK();
+    }
+
+    // >> every kernel rejects an empty column range, rather than zero-filling its rows
+    if (col_stopndx <= col_startndx) {
+        return Status::Invalid("Slice has no columns to aggregate");
+    }
+
+    // >> vec and arrow kernels: a fresh aggregate per slice, copied into our rows of the result
+    if (options.kernel == AggrKernel::Vec or options.kernel == AggrKernel::Arrow) {
+        MeanAggr slice_aggr { options };
+        ARROW_RETURN_NOT_OK(slice_aggr.Accumulate(slice_table, col_startndx, col_stopndx));
+        if (slice_aggr.count == 0) {
+            return Status::Invalid("Slice has no columns to aggregate");
+        }
+
+        CopyDoubles(slice_aggr.means    , slice_means);
+        CopyDoubles(slice_aggr.variances, slice_m2   );
+        next_rowndx += slice_rows;
+
+        return Status::OK();
+    }
+
+    // >> fused and tiled kernels write straight into our rows of the result. Types are
+    //    checked once per (schema, column range), since any other column is read as float64
+    bool range_checked = (
+            slice_table->schema() == checked_schema
+        and col_startndx          == checked_startndx
+        and col_stopndx           == checked_stopndx
+    );
+
+    if (not range_checked) {
+        for (int64_t col_ndx = col_startndx; col_ndx < col_stopndx; ++col_ndx) {
+            auto col_type = slice_table->schema()->field(col_ndx)->type();
+            if (not IsSampleType(*col_type)) {
+                return Status::TypeError(
+                    "Fused kernel expects float32 or float64 columns; column ", col_ndx
+                   ," is ", col_type->ToString()
+                );
+            }
+        }
+
+        checked_schema   = slice_table->schema();
+        checked_startndx = col_startndx;
+        checked_stopndx  = col_stopndx;
+    }
+
+    slice_cols.clear();
+    for (int64_t col_ndx = col_startndx; col_ndx < col_stopndx; ++col_ndx) {
+        const auto &col_vals = slice_table->column(col_ndx);
+        if (col_vals->null_count() > 0) {
+            return Status::Invalid(
+                "Fused kernel does not support null values (column ", col_ndx, ")"
+            );
+        }
+
+        slice_cols.push_back(col_vals.get());
+    }
+
+    std::fill(slice_means, slice_means + slice_rows, 0.0);
+    std::fill(slice_m2   , slice_m2    + slice_rows, 0.0);
+
+    int64_t tile_rows = (
+          options.kernel == AggrKernel::Tiled
+        ? options.tile_rows
+        : std::max(slice_rows, int64_t { 1 })
+    );
+
+    // rows of the slice are split across `thread_count` ranges, like `AccumulateInPlace`
+    ARROW_RETURN_NOT_OK(ForEachRowRange(
+         slice_rows
+        ,options
+        ,[&](int64_t range_start, int64_t range_stop) {
+             AccumulateRowRange(
+                  slice_cols
+                 ,slice_means
+                 ,slice_m2
+                 ,0
+                 ,range_start
+                 ,range_stop
+                 ,tile_rows
+             );
+         }
+    ));
+
+    next_rowndx += slice_rows;
+
+    return Status::OK();
+}
+
+shared_ptr<Table>
+SliceAggr::TakeResult() {
+  auto result_schema = arrow::schema({
+        arrow::field("mean"    , arrow::float64())
+       ,arrow::field("variance", arrow::float64())
+  });
+
+  // only rows that have been aggregated are part of the result
+  auto result_means = std::make_shared<arrow::DoubleArray>(next_rowndx, means_buffer);
+  auto result_vars  = std::make_shared<arrow::DoubleArray>(next_rowndx, variances_buffer);
+
+  means_buffer.reset();
+  variances_buffer.reset();
+  slice_status = Status::Invalid("Result has already been taken");
+
+  return Table::Make(result_schema, {
+       std::make_shared<ChunkedArray>(result_means)
+      ,std::make_shared<ChunkedArray>(result_vars)
+  });
+}
+
+
+
+// >> PairwiseTStat implementation
+
+/**
+ * `ComputeTStatWith` scales each group's variances by (n - 1) / n for every pair; that
+ * term only depends on the group, so it is computed here, once per group.
+ */
+Status
+PairwiseTStat::AddGroup(const std::string &group_name, const MeanAggr &group_aggr) {
+    if (group_aggr.count < 2) {
+        return Status::Invalid("Group [", group_name, "] aggregates fewer than 2 samples");
+    }
+
+    for (const auto &state_vals : { group_aggr.means, group_aggr.variances }) {
+        if (state_vals == nullptr or state_vals->type()->id() != arrow::Type::DOUBLE) {
+            return Status::TypeError("Group [", group_name, "] has no float64 mean and variance");
+        }
+    }
+
+    if (group_names.empty()) { gene_count = group_aggr.means->length(); }
+    if (   group_aggr.means->length()     != gene_count
+        or group_aggr.variances->length() != gene_count) {
+        return Status::Invalid(
+            "Group [", group_name, "] has ", group_aggr.means->length(), " genes; expected ", gene_count
+        );
+    }
+
+    size_t group_offset = group_means.size();
+    group_means.resize(group_offset + gene_count);
+    group_terms.resize(group_offset + gene_count);
+
+    CopyDoubles(group_aggr.means    , group_means.data() + group_offset);
+    CopyDoubles(group_aggr.variances, group_terms.data() + group_offset);
+
+    double group_size = static_cast<double>(group_aggr.count);
+    for (int64_t gene_ndx = 0; gene_ndx < gene_count; ++gene_ndx) {
+        auto &gene_term = group_terms[group_offset + gene_ndx];
+        gene_term       = (gene_term / group_size) * (group_size - 1);
+    }
+
+    group_names.push_back(group_name);
+    group_sizes.push_back(group_aggr.count);
+
+    return Status::OK();
+}
+
+shared_ptr<Schema>
+PairwiseTStat::result_schema() const {
+    return arrow::schema({
+         arrow::field("left"       , arrow::utf8())
+        ,arrow::field("right"      , arrow::utf8())
+        ,arrow::field("t-statistic", arrow::fixed_size_list(arrow::float64(), static_cast<int32_t>(gene_count)))
+    });
+}
+
+/**
+ * For groups i and j, with per-gene terms a = var * (n - 1) / n:
+ *   t = (mean_i - mean_j) / (sqrt((a_i + a_j) / (n_i + n_j - 2)) * sqrt(1/n_i + 1/n_j))
+ * Everything but the means and terms depends only on (n_i, n_j), so each pair folds it
+ * into 1 scale factor: t = (mean_i - mean_j) * pair_scale / sqrt(a_i + a_j).
+ */
+Status
+PairwiseTStat::ComputeAllPairs(int64_t pair_limit, const BatchSink &sink) {
+    if (pair_limit <= 0) { return Status::Invalid("Expected a positive number of pairs per batch"); }
+
+    int64_t tile_rows  = std::max(options.tile_rows, int64_t { 8 });
+    int32_t left_ndx   = 0;
+    int32_t right_ndx  = 1;
+    for (int64_t pair_start = 0; pair_start < pair_count(); pair_start += pair_limit) {
+        int64_t batch_pairs = std::min(pair_limit, pair_count() - pair_start);
+
+        // >> the pairs of this batch, and their scale factors
+        std::vector<std::pair<int32_t, int32_t>> batch_groups;
+        std::vector<double>                      pair_scales;
+        arrow::StringBuilder                     left_builder;
+        arrow::StringBuilder                     right_builder;
+        for (int64_t pair_ndx = 0; pair_ndx < batch_pairs; ++pair_ndx) {
+            double left_size  = static_cast<double>(group_sizes[left_ndx]);
+            double right_size = static_cast<double>(group_sizes[right_ndx]);
+
+            batch_groups.emplace_back(left_ndx, right_ndx);
+            pair_scales.push_back(
+                  std::sqrt(left_size + right_size - 2)
+                / std::sqrt((1.0 / left_size) + (1.0 / right_size))
+            );
+
+            ARROW_RETURN_NOT_OK(left_builder.Append(group_names[left_ndx]));
+            ARROW_RETURN_NOT_OK(right_builder.Append(group_names[right_ndx]));
+
+            if (++right_ndx == group_count()) { ++left_ndx; right_ndx = left_ndx + 1; }
+        }
+
+        // >> t-statistics: 1 row of `gene_count` values per pair
+        ARROW_ASSIGN_OR_RAISE(
+             auto tstat_buffer
+            ,arrow::AllocateBuffer(
+                 batch_pairs * gene_count * static_cast<int64_t>(sizeof(double))
+                ,options.memory_pool()
+             )
+        );
+
+        auto tstat_vals = reinterpret_cast<double *>(tstat_buffer->mutable_data());
+        ARROW_RETURN_NOT_OK(ForEachRowRange(
+             gene_count
+            ,options
+            ,[&](int64_t range_start, int64_t range_stop) {
+                 for (int64_t tile_start = range_start; tile_start < range_stop; tile_start += tile_rows) {
+                     int64_t tile_stop = std::min(tile_start + tile_rows, range_stop);
+
+                     for (int64_t pair_ndx = 0; pair_ndx < batch_pairs; ++pair_ndx) {
+                         const double *left_means  = group_means.data() + batch_groups[pair_ndx].first  * gene_count;
+                         const double *left_terms  = group_terms.data() + batch_groups[pair_ndx].first  * gene_count;
+                         const double *right_means = group_means.data() + batch_groups[pair_ndx].second * gene_count;
+                         const double *right_terms = group_terms.data() + batch_groups[pair_ndx].second * gene_count;
+                         double       *pair_tstats = tstat_vals + pair_ndx * gene_count;
+                         double        pair_scale  = pair_scales[pair_ndx];
+
+                         for (int64_t gene_ndx = tile_start; gene_ndx < tile_stop; ++gene_ndx) {
+                             pair_tstats[gene_ndx] = (
+                                   (left_means[gene_ndx] - right_means[gene_ndx]) * pair_scale
+                                 / std::sqrt(left_terms[gene_ndx] + right_terms[gene_ndx])
+                             );
+                         }
+                     }
+                 }
+             }
+        ));
+
+        auto tstat_flat = std::make_shared<arrow::DoubleArray>(
+            batch_pairs * gene_count, std::move(tstat_buffer)
+        );
+
+        ARROW_ASSIGN_OR_RAISE(
+             auto tstat_rows
+            ,arrow::FixedSizeListArray::FromArrays(tstat_flat, static_cast<int32_t>(gene_count))
+        );
+
+        ARROW_ASSIGN_OR_RAISE(auto left_names , left_builder.Finish());
+        ARROW_ASSIGN_OR_RAISE(auto right_names, right_builder.Finish());
+        ARROW_RETURN_NOT_OK(sink(RecordBatch::Make(
+             result_schema()
+            ,batch_pairs
+            ,{ left_names, right_names, tstat_rows }
+        )));
+    }
+
+    return Status::OK();
+}
+
+
 /**
  * Compute partial aggregate from `src_table`, and then return the time to calculate
  * the aggregate. Store the result in the shared_ptr pointed to by `aggr_result`.
  */
-std::chrono::milliseconds
+std::chrono::nanoseconds
 AggrTable( shared_ptr<Table>  src_table
           ,int64_t            col_startndx
           ,int64_t            col_limit
-          ,shared_ptr<Table> *aggr_result) {
-  MeanAggr partial_aggr;
+          ,shared_ptr<Table> *aggr_result
+          ,AggrOptions        aggr_opts) {
+  MeanAggr partial_aggr { aggr_opts };
 
-  int64_t col_stopndx = src_table->num_columns();
-  if (col_limit > 0 and col_startndx + col_limit < col_stopndx) {
-    col_stopndx = col_startndx + col_limit;
-  }
+  int64_t col_stopndx = AggrColumnStop(src_table, col_startndx, col_limit);
 
   auto aggr_tstart = std::chrono::steady_clock::now();
   auto status_aggr = partial_aggr.Accumulate(src_table, col_startndx, col_stopndx);
@@ -252,5 +1698,5 @@ AggrTable( shared_ptr<Table>  src_table
               << std::endl;
   }
 
-  return std::chrono::duration_cast<std::chrono::milliseconds>(aggr_tstop - aggr_tstart);
+  return aggr_tstop - aggr_tstart;
 }
@@ -20,11 +20,77 @@
 // Dependencies
 #pragma once
 
+#include <functional>
+
 // brings in all Apache Arrow dependencies
 #include "adapter_arrow.hpp"
 #include "util_arrow.hpp"
 
 
+// ------------------------------
+// Types
+
+// Selects how `MeanAggr::Accumulate` applies each column to the running state:
+//  - Vec  : the reference path; a chain of arrow compute calls (VecSub, VecDiv, ...).
+//           It also selects the reference `Combine` and `ComputeTStatWith`; every other
+//           kernel uses their fused versions (1 pass, no intermediate arrays)
+//  - Fused: a single pass over raw double buffers that updates state in place
+//  - Tiled: the fused update, but all columns are swept over one block of rows (a tile)
+//           before moving to the next block, so the state for that block stays in cache
+//  - Arrow: the registered "welford_rows" function (see kernels_arrow.hpp), called by
+//           arrow's executor on the column batch of each row range
+enum class AggrKernel { Vec, Fused, Tiled, Arrow };
+
+Result<AggrKernel> AggrKernelFromName(const std::string &kernel_name);
+const char*        AggrKernelName(AggrKernel kernel);
+
+// The matrix layout (see `IsMatrixLayout`) has 1 kernel, a fused pass over each row's
+// samples, so only `Fused` selects it; other kernels are an error rather than ignored
+Status CheckLayoutKernel(const Schema &table_schema, AggrKernel kernel);
+
+// Default tile: 4096 rows of mean and M2 is 64 KiB of state, which fits in L2 with room
+// for the column values streaming through
+constexpr int64_t default_tile_rows = 4096;
+
+// `thread_count` is the number of row ranges the fused and tiled kernels accumulate in
+// parallel; the vec kernel always runs on 1 thread. `col_partitions` > 1 instead splits
+// the columns into disjoint ranges that are each accumulated in parallel, then merged
+// with `MeanAggr::Combine`.
+//
+// `exec_ctx` runs the compute functions (and so allocates the vec kernel's intermediates);
+// state, results and the other kernels' buffers come from its memory pool too, and row
+// ranges and column partitions run on its executor. Null (or a null executor) uses arrow's
+// CPU thread pool, which also decompresses IPC input. It must outlive the aggregates that
+// use these options.
+struct AggrOptions {
+    AggrKernel   kernel         { AggrKernel::Fused };
+    int64_t      tile_rows      { default_tile_rows };
+    int          thread_count   { 1                 };
+    int          col_partitions { 1                 };
+    ExecContext *exec_ctx       { nullptr           };
+
+    MemoryPool* memory_pool() const;
+    Executor*   executor()    const;
+};
+
+
+// Serialized aggregate state (see `MeanAggr::StateTable`): columns (key, mean, variance),
+// and the sample count as schema metadata under `aggr_count_key`
+constexpr const char *aggr_count_key = "aggr_count";
+
+Result<uint64_t> GetAggrCount(shared_ptr<const KVMetadata> table_meta);
+
+// Columns of `table_data` as aggregation sees them: the key column plus 1 per sample.
+// For the matrix layout (see `IsMatrixLayout`), that is 1 + the sample block width, so
+// column indices and limits mean the same thing for both layouts.
+int64_t AggrColumnCount(shared_ptr<Table> table_data);
+int64_t AggrColumnCount(const Schema &table_schema);
+
+// End (exclusive) of the columns aggregated from `col_startndx`: at most `col_limit` of
+// them, or every remaining column when `col_limit` is not positive
+int64_t AggrColumnStop(shared_ptr<Table> table_data, int64_t col_startndx, int64_t col_limit);
+
+
 // ------------------------------
 // Classes
 
@@ -32,26 +98,176 @@ struct MeanAggr {
     uint64_t                 count;
     shared_ptr<ChunkedArray> means;
     shared_ptr<ChunkedArray> variances;
+    AggrOptions              options;
 
-    MeanAggr(): count(0), means(nullptr), variances(nullptr) {};
+    MeanAggr(AggrOptions aggr_opts = AggrOptions {})
+        : count(0), means(nullptr), variances(nullptr), options(aggr_opts) {};
 
     Status PrintM1M2();
     Status PrintState();
 
     Status Initialize(shared_ptr<ChunkedArray> initial_vals);
+    // Merges `other_aggr` into this aggregate. Either may be updated afterwards: state is
+    // only shared while neither one can modify it in place.
     Status Combine(const MeanAggr *other_aggr);
+    Status CombineVec(const MeanAggr *other_aggr);
+    Status CombineFused(const MeanAggr *other_aggr);
+
     Status Accumulate( shared_ptr<Table> new_vals
                       ,int64_t           col_startndx = 1
                       ,int64_t           col_stopndx  = 0);
 
+    Status AccumulateVec( shared_ptr<Table> new_vals
+                         ,int64_t           col_startndx
+                         ,int64_t           col_stopndx);
+
+    Status AccumulateFused( shared_ptr<Table> new_vals
+                           ,int64_t           col_startndx
+                           ,int64_t           col_stopndx);
+
+    Status AccumulateTiled( shared_ptr<Table> new_vals
+                           ,int64_t           col_startndx
+                           ,int64_t           col_stopndx);
+
+    Status AccumulateArrow( shared_ptr<Table> new_vals
+                           ,int64_t           col_startndx
+                           ,int64_t           col_stopndx);
+
+    Status AccumulateMatrix( shared_ptr<Table> new_vals
+                            ,int64_t           col_startndx
+                            ,int64_t           col_stopndx);
+
+    Status AccumulatePartitioned( shared_ptr<Table> new_vals
+                                 ,int64_t           col_startndx
+                                 ,int64_t           col_stopndx);
+
     shared_ptr<Table> TakeResult();
+
+    // 1 column, "t-statistic"; null if it couldn't be computed (e.g. the aggregates have
+    // different row counts, or allocation failed)
     shared_ptr<Table> ComputeTStatWith(const MeanAggr &other_aggr);
+    shared_ptr<Table> ComputeTStatVec(const MeanAggr &other_aggr);
+
+    // Fused: writes 1 t-statistic per row into `tstat_vals`, which must have room for them
+    Status ComputeTStatInto(const MeanAggr &other_aggr, double *tstat_vals) const;
+
+    // >> Serialized state, with the row keys (e.g. gene IDs) and count embedded
+    Result<shared_ptr<Table>>
+    StateTable(shared_ptr<Field> key_field, shared_ptr<ChunkedArray> row_keys) const;
+
+    Result<shared_ptr<Buffer>>
+    Serialize(shared_ptr<Field> key_field, shared_ptr<ChunkedArray> row_keys) const;
+
+    // The state columns of the result point into `state_table` (or `state_buffer`); if
+    // `row_keys` is given, it gets the key column
+    static Result<MeanAggr> FromStateTable( shared_ptr<Table>         state_table
+                                           ,shared_ptr<ChunkedArray> *row_keys  = nullptr
+                                           ,AggrOptions               aggr_opts = AggrOptions {});
+
+    static Result<MeanAggr> Deserialize( shared_ptr<Buffer>         state_buffer
+                                        ,shared_ptr<ChunkedArray> *row_keys  = nullptr
+                                        ,AggrOptions               aggr_opts = AggrOptions {});
+
+    // Memory maps the file by default, so the state is read (paged in) where it is used
+    static Result<MeanAggr> DeserializeFile( const std::string         &path_as_uri
+                                            ,shared_ptr<ChunkedArray>  *row_keys    = nullptr
+                                            ,IOStrategy                 io_strategy = IOStrategy::Mmap
+                                            ,AggrOptions                aggr_opts   = AggrOptions {});
+
+    private:
+        // Buffers that back `means` and `variances` when they are owned (and may be
+        // updated in place) by the fused kernel
+        shared_ptr<Buffer> means_buffer;
+        shared_ptr<Buffer> variances_buffer;
+
+        bool   OwnsState() const;
+        Status PrepareMutableState(int64_t row_count);
+        Status AccumulateInPlace( shared_ptr<Table> new_vals
+                                 ,int64_t           col_startndx
+                                 ,int64_t           col_stopndx
+                                 ,int64_t           tile_rows);
+};
+
+
+/**
+ * Aggregates a sequence of row slices of one table (e.g. its RecordBatches) into a single
+ * result with one row per table row. Rows are independent, so each slice is accumulated
+ * directly into its rows of the result, split across `thread_count` row ranges as for a
+ * whole table. Output buffers are allocated once and column types are checked once per
+ * schema and column range, so per-slice overhead is a pass over the columns. An empty
+ * column range is an error for every kernel.
+ */
+struct SliceAggr {
+    AggrOptions options;
+
+    SliceAggr(AggrOptions aggr_opts, int64_t total_rows);
+
+    std::chrono::nanoseconds
+    AggrSlice(shared_ptr<Table> slice_table, int64_t col_startndx, int64_t col_limit);
+
+    Status            status() const { return slice_status; }
+    int64_t           rows_aggregated() const { return next_rowndx; }
+    shared_ptr<Table> TakeResult();
+
+    private:
+        int64_t            row_count;
+        int64_t            next_rowndx;
+        Status             slice_status;
+        shared_ptr<Buffer> means_buffer;
+        shared_ptr<Buffer> variances_buffer;
+
+        // reused across slices
+        shared_ptr<Schema>                checked_schema;
+        int64_t                           checked_startndx { 0 };
+        int64_t                           checked_stopndx  { 0 };
+        std::vector<const ChunkedArray *> slice_cols;
+
+        Status AccumulateSlice(shared_ptr<Table> slice_table, int64_t col_startndx, int64_t col_stopndx);
+};
+
+
+/**
+ * T-statistics for every pair of K groups (e.g. metaclusters), given each group's partial
+ * aggregate over the same (aligned) genes. `AddGroup` computes a group's per-gene terms
+ * once, so each pair costs a subtract, an add, a sqrt and a multiply per gene. Pairs
+ * (i, j), i < j, are evaluated in order, `pair_limit` at a time; each set is passed to
+ * `sink` as 1 RecordBatch of (left group, right group, t-statistic per gene) rows, so the
+ * K*(K-1)/2 results are never all in memory. Genes are split into `thread_count` ranges,
+ * each swept `tile_rows` genes at a time over every pair of the batch, so the groups'
+ * terms for a tile stay in cache.
+ */
+class PairwiseTStat {
+  public:
+    using BatchSink = std::function<Status(shared_ptr<RecordBatch>)>;
+
+    PairwiseTStat(AggrOptions aggr_opts = AggrOptions {}) : options(aggr_opts) {}
+
+    Status AddGroup(const std::string &group_name, const MeanAggr &group_aggr);
+
+    int64_t group_count() const { return static_cast<int64_t>(group_names.size()); }
+    int64_t pair_count()  const { return group_count() * (group_count() - 1) / 2;  }
+
+    // "left" and "right" group names, then "t-statistic": fixed_size_list<double>[genes]
+    shared_ptr<Schema> result_schema() const;
+
+    Status ComputeAllPairs(int64_t pair_limit, const BatchSink &sink);
+
+  private:
+    AggrOptions options;
+    int64_t     gene_count { 0 };
+
+    // per group; `group_means` and `group_terms` are group-major (group_count x gene_count)
+    std::vector<std::string> group_names;
+    std::vector<uint64_t>    group_sizes;
+    std::vector<double>      group_means;
+    std::vector<double>      group_terms;
 };
 
 
 // Convenience function that times aggregation of a single table
-std::chrono::milliseconds
+std::chrono::nanoseconds
 AggrTable( shared_ptr<Table>  src_table
           ,int64_t            col_startndx
           ,int64_t            col_limit
-          ,shared_ptr<Table> *aggr_result);
+          ,shared_ptr<Table> *aggr_result
+          ,AggrOptions        aggr_opts = AggrOptions {});
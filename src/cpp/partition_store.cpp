@@ -0,0 +1,537 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#include <filesystem>
+#include <unistd.h>
+
+#include "experiments.hpp"
+#include "partition_store.hpp"
+
+
+// ------------------------------
+// Variables
+
+// schema metadata of a partition's key: how many slices it is stored in
+static const std::string slice_count_key { "slice_count" };
+
+// schema metadata of an aggregate snapshot (and of its dataset's latest-snapshot key)
+static const std::string aggr_version_key { "aggr_version" };
+static const std::string aggr_columns_key { "aggr_columns" };
+
+
+// ------------------------------
+// Functions
+
+static std::string
+SliceKey(const std::string &key, int64_t slice_ndx) {
+    return key + ";" + std::to_string(slice_ndx);
+}
+
+static std::string
+LatestSnapshotKey(const std::string &dataset_key) {
+    return dataset_key + ".aggr";
+}
+
+static std::string
+SnapshotKey(const std::string &dataset_key, int64_t version) {
+    return LatestSnapshotKey(dataset_key) + ".v" + std::to_string(version);
+}
+
+static Result<int64_t>
+GetMetaInt(const KVMetadata &table_meta, const std::string &meta_key) {
+    ARROW_ASSIGN_OR_RAISE(auto meta_val, table_meta.Get(meta_key));
+
+    char    *val_end = nullptr;
+    int64_t  int_val = std::strtoll(meta_val.c_str(), &val_end, 10);
+    if (meta_val.empty() or *val_end != '\0') {
+        return Status::Invalid("Invalid [", meta_key, "]: '", meta_val, "'");
+    }
+
+    return int_val;
+}
+
+// Column ranges as "start:stop,start:stop,..."
+static std::string
+FormatColumnRanges(const std::vector<ColumnRange> &col_ranges) {
+    std::string ranges_str;
+    for (const auto &col_range : col_ranges) {
+        if (not ranges_str.empty()) { ranges_str += ","; }
+        ranges_str += std::to_string(col_range.start) + ":" + std::to_string(col_range.stop);
+    }
+
+    return ranges_str;
+}
+
+static Result<std::vector<ColumnRange>>
+ParseColumnRanges(const std::string &ranges_str) {
+    std::vector<ColumnRange> col_ranges;
+    std::stringstream        range_strs { ranges_str };
+    std::string              range_str;
+
+    while (std::getline(range_strs, range_str, ',')) {
+        ColumnRange col_range;
+        char        range_sep = 0;
+
+        std::stringstream range_vals { range_str };
+        range_vals >> col_range.start >> range_sep >> col_range.stop;
+        if (range_vals.fail() or not range_vals.eof() or range_sep != ':' or col_range.start > col_range.stop) {
+            return Status::Invalid("Invalid column range: '", range_str, "'");
+        }
+
+        // each fold starts where the previous one stopped
+        int64_t prev_stop = col_ranges.empty() ? 1 : col_ranges.back().stop;
+        if (col_range.start != prev_stop) {
+            return Status::Invalid("Column range '", range_str, "' doesn't start at ", prev_stop);
+        }
+
+        col_ranges.push_back(col_range);
+    }
+
+    return col_ranges;
+}
+
+
+// >> PartitionStore
+
+Result<shared_ptr<Buffer>>
+PartitionStore::GetKey(const std::string &key) {
+    auto get_tstart = std::chrono::steady_clock::now();
+
+    if (get_delay.count() > 0) { std::this_thread::sleep_for(get_delay); }
+    ARROW_ASSIGN_OR_RAISE(auto key_val, ReadValue(key));
+
+    auto get_tstop  = std::chrono::steady_clock::now();
+
+    get_count  += 1;
+    bytes_read += key_val->size();
+    get_nanos  += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        get_tstop - get_tstart
+    ).count();
+
+    return key_val;
+}
+
+Result<bool>
+PartitionStore::HasKey(const std::string &key) {
+    return ContainsValue(key);
+}
+
+Status
+PartitionStore::PutKey(const std::string &key, shared_ptr<Buffer> key_val) {
+    ARROW_RETURN_NOT_OK(WriteValue(key, key_val));
+
+    put_count     += 1;
+    bytes_written += key_val->size();
+
+    return Status::OK();
+}
+
+/**
+ * Write the slices first and the partition's key last, so the partition can't be read
+ * until every slice is in place.
+ */
+Status
+PartitionStore::PutPartitionData( const std::string &key
+                                 ,shared_ptr<Table>  table_data
+                                 ,int64_t            slice_rows) {
+    if (slice_rows <= 0) { return Status::Invalid("Slices need at least 1 row"); }
+
+    int64_t slice_count = 0;
+    for (int64_t row_ndx = 0; row_ndx < table_data->num_rows(); row_ndx += slice_rows) {
+        ARROW_ASSIGN_OR_RAISE(
+             auto slice_buffer
+            ,WriteTableToBuffer(table_data->Slice(row_ndx, slice_rows))
+        );
+
+        ARROW_RETURN_NOT_OK(PutKey(SliceKey(key, slice_count), slice_buffer));
+        ++slice_count;
+    }
+
+    auto key_meta = (
+          table_data->schema()->HasMetadata()
+        ? table_data->schema()->metadata()->Copy()
+        : std::make_shared<KVMetadata>()
+    );
+
+    ARROW_RETURN_NOT_OK(key_meta->Set(slice_count_key, std::to_string(slice_count)));
+    ARROW_ASSIGN_OR_RAISE(
+         auto empty_table
+        ,Table::MakeEmpty(table_data->schema()->WithMetadata(key_meta))
+    );
+
+    ARROW_ASSIGN_OR_RAISE(auto key_buffer, WriteTableToBuffer(empty_table));
+    return PutKey(key, key_buffer);
+}
+
+Result<shared_ptr<Table>>
+PartitionStore::GetPartitionData(const std::string &key) {
+    return MapPartitionData(key, 1);
+}
+
+/**
+ * Read the partition's key, then its slices: each of `qdepth` threads reads (and decodes)
+ * the next unread slice until none are left, so up to `qdepth` reads are in flight. The
+ * slices are concatenated in order, without copying.
+ */
+Result<shared_ptr<Table>>
+PartitionStore::MapPartitionData(const std::string &key, size_t qdepth) {
+    ARROW_ASSIGN_OR_RAISE(auto key_buffer, GetKey(key));
+    ARROW_ASSIGN_OR_RAISE(auto key_table , ReadTableFromBuffer(key_buffer));
+
+    auto key_meta = key_table->schema()->metadata();
+    if (key_meta == nullptr or key_meta->FindKey(slice_count_key) < 0) {
+        return Status::Invalid("Key [", key, "] is not a partition");
+    }
+
+    ARROW_ASSIGN_OR_RAISE(int64_t slice_count, GetMetaInt(*key_meta, slice_count_key));
+    if (slice_count < 0) {
+        return Status::Invalid("Partition [", key, "] has a negative slice count: ", slice_count);
+    }
+
+    auto part_meta = key_meta->Copy();
+    ARROW_RETURN_NOT_OK(part_meta->Delete(slice_count_key));
+
+    auto part_schema = key_table->schema()->WithMetadata(part_meta);
+    if (slice_count == 0) { return Table::MakeEmpty(part_schema); }
+
+    std::vector<Result<shared_ptr<Table>>> slice_tables(
+        slice_count, Result<shared_ptr<Table>> { Status::UnknownError("Slice not read") }
+    );
+
+    std::atomic<int64_t> next_slicendx { 0 };
+    auto ReadSlices = [&]() {
+        for (int64_t slice_ndx = next_slicendx++; slice_ndx < slice_count; slice_ndx = next_slicendx++) {
+            auto slice_buffer = GetKey(SliceKey(key, slice_ndx));
+
+            if (not slice_buffer.ok()) { slice_tables[slice_ndx] = slice_buffer.status();            }
+            else                       { slice_tables[slice_ndx] = ReadTableFromBuffer(*slice_buffer); }
+        }
+    };
+
+    size_t thread_count = std::min(std::max(qdepth, size_t { 1 }), static_cast<size_t>(slice_count));
+    if (thread_count == 1) { ReadSlices(); }
+    else {
+        std::vector<std::thread> read_threads;
+        for (size_t thread_ndx = 0; thread_ndx < thread_count; ++thread_ndx) {
+            read_threads.emplace_back(ReadSlices);
+        }
+
+        for (auto &read_thread : read_threads) { read_thread.join(); }
+    }
+
+    std::vector<shared_ptr<Table>> part_slices;
+    part_slices.reserve(slice_count);
+    for (auto &slice_table : slice_tables) {
+        ARROW_RETURN_NOT_OK(slice_table.status());
+        part_slices.push_back((*slice_table)->ReplaceSchemaMetadata(part_meta));
+    }
+
+    return arrow::ConcatenateTables(part_slices);
+}
+
+StoreStats
+PartitionStore::Stats() const {
+    StoreStats store_stats;
+    store_stats.get_count     = get_count;
+    store_stats.put_count     = put_count;
+    store_stats.bytes_read    = bytes_read;
+    store_stats.bytes_written = bytes_written;
+    store_stats.get_time      = std::chrono::nanoseconds { get_nanos.load() };
+
+    return store_stats;
+}
+
+void
+PartitionStore::PrintStats() const {
+    auto   store_stats = Stats();
+    double get_millis  = MillisDouble { store_stats.get_time }.count();
+
+    std::cout << "Store statistics:"                                        << std::endl
+              << "\tgets   : " << store_stats.get_count                     << std::endl
+              << "\tputs   : " << store_stats.put_count                     << std::endl
+              << "\tread   : " << store_stats.bytes_read    << " bytes"     << std::endl
+              << "\twritten: " << store_stats.bytes_written << " bytes"     << std::endl
+              << "\tget latency (sum): " << get_millis << "ms"              << std::endl
+    ;
+}
+
+
+// >> LocalDirStore
+
+// keys may start with '/', but always name a file under the store's root
+std::string
+LocalDirStore::PathForKey(const std::string &key) const {
+    auto key_start = key.find_first_not_of('/');
+    auto key_path  = key_start == std::string::npos ? std::string {} : key.substr(key_start);
+
+    return (std::filesystem::absolute(root_dirpath) / key_path).string();
+}
+
+Result<shared_ptr<Buffer>>
+LocalDirStore::ReadValue(const std::string &key) {
+    ARROW_ASSIGN_OR_RAISE(auto value_file, arrow::io::ReadableFile::Open(PathForKey(key)));
+    ARROW_ASSIGN_OR_RAISE(auto value_size, value_file->GetSize());
+    ARROW_ASSIGN_OR_RAISE(auto key_val   , value_file->Read(value_size));
+    ARROW_RETURN_NOT_OK(value_file->Close());
+
+    return key_val;
+}
+
+Result<bool>
+LocalDirStore::ContainsValue(const std::string &key) {
+    std::error_code fs_err;
+    bool            has_value = std::filesystem::is_regular_file(PathForKey(key), fs_err);
+    if (fs_err and fs_err != std::errc::no_such_file_or_directory) {
+        return Status::IOError("Couldn't check for key [", key, "]: ", fs_err.message());
+    }
+
+    return has_value;
+}
+
+// Write to a temporary file, then rename it, so readers never see a partial value
+Status
+LocalDirStore::WriteValue(const std::string &key, shared_ptr<Buffer> key_val) {
+    static std::atomic<int64_t> write_count { 0 };
+
+    std::filesystem::path value_fpath { PathForKey(key) };
+
+    std::error_code fs_err;
+    std::filesystem::create_directories(value_fpath.parent_path(), fs_err);
+    if (fs_err) {
+        return Status::IOError("Couldn't create [", value_fpath.parent_path().string(), "]: ", fs_err.message());
+    }
+
+    // unique per write, so concurrent puts of 1 key don't share a temporary file
+    std::string temp_fpath {
+          value_fpath.string() + ".tmp." + std::to_string(getpid())
+        + "." + std::to_string(write_count++)
+    };
+    ARROW_ASSIGN_OR_RAISE(auto value_file, arrow::io::FileOutputStream::Open(temp_fpath));
+    ARROW_RETURN_NOT_OK(value_file->Write(key_val));
+    ARROW_RETURN_NOT_OK(value_file->Close());
+
+    std::filesystem::rename(temp_fpath, value_fpath, fs_err);
+    if (fs_err) {
+        std::filesystem::remove(temp_fpath);
+        return Status::IOError("Couldn't write [", value_fpath.string(), "]: ", fs_err.message());
+    }
+
+    return Status::OK();
+}
+
+
+// >> MemoryStore
+
+Result<shared_ptr<Buffer>>
+MemoryStore::ReadValue(const std::string &key) {
+    std::lock_guard<std::mutex> values_guard { values_lock };
+
+    auto key_val = key_values.find(key);
+    if (key_val == key_values.end()) { return Status::KeyError("No value for key [", key, "]"); }
+
+    return key_val->second;
+}
+
+Status
+MemoryStore::WriteValue(const std::string &key, shared_ptr<Buffer> key_val) {
+    std::lock_guard<std::mutex> values_guard { values_lock };
+    key_values[key] = std::move(key_val);
+
+    return Status::OK();
+}
+
+Result<bool>
+MemoryStore::ContainsValue(const std::string &key) {
+    std::lock_guard<std::mutex> values_guard { values_lock };
+    return key_values.count(key) > 0;
+}
+
+
+// >> AggrSnapshotStore
+
+int64_t
+AggrSnapshot::NextColumn() const {
+    return col_ranges.empty() ? 1 : col_ranges.back().stop;
+}
+
+Result<int64_t>
+AggrSnapshotStore::LatestVersion(const std::string &dataset_key) {
+    auto latest_key = LatestSnapshotKey(dataset_key);
+
+    ARROW_ASSIGN_OR_RAISE(auto has_snapshot, store.HasKey(latest_key));
+    if (not has_snapshot) { return 0; }
+
+    ARROW_ASSIGN_OR_RAISE(auto latest_buffer, store.GetKey(latest_key));
+    ARROW_ASSIGN_OR_RAISE(auto latest_table , ReadTableFromBuffer(latest_buffer));
+
+    auto latest_meta = latest_table->schema()->metadata();
+    if (latest_meta == nullptr) {
+        return Status::Invalid("Key [", latest_key, "] has no [", aggr_version_key, "]");
+    }
+
+    return GetMetaInt(*latest_meta, aggr_version_key);
+}
+
+Result<AggrSnapshot>
+AggrSnapshotStore::ReadSnapshot(const std::string &dataset_key, int64_t version) {
+    if (version == 0) { ARROW_ASSIGN_OR_RAISE(version, LatestVersion(dataset_key)); }
+
+    AggrSnapshot snapshot;
+    if (version == 0) { return snapshot; }
+
+    ARROW_ASSIGN_OR_RAISE(
+         auto state_table
+        ,store.MapPartitionData(SnapshotKey(dataset_key, version), qdepth)
+    );
+
+    ARROW_ASSIGN_OR_RAISE(snapshot.aggr, MeanAggr::FromStateTable(state_table, &snapshot.row_keys));
+    snapshot.key_field = state_table->schema()->field(0);
+
+    // >> the version and column ranges are always written with the state
+    auto state_meta = state_table->schema()->metadata();
+    ARROW_ASSIGN_OR_RAISE(snapshot.version   , GetMetaInt(*state_meta, aggr_version_key));
+    ARROW_ASSIGN_OR_RAISE(auto ranges_str    , state_meta->Get(aggr_columns_key));
+    ARROW_ASSIGN_OR_RAISE(snapshot.col_ranges, ParseColumnRanges(ranges_str));
+
+    return snapshot;
+}
+
+/**
+ * The new columns are aggregated on their own, then merged into (a copy of) the base
+ * snapshot's state, so the work is proportional to the new columns. The snapshot is
+ * written before the latest-snapshot key points to it.
+ */
+Result<AggrSnapshot>
+AggrSnapshotStore::FoldColumns( const std::string  &dataset_key
+                               ,const AggrSnapshot &base_snapshot
+                               ,shared_ptr<Table>   new_vals
+                               ,int64_t             col_startndx
+                               ,int64_t             col_stopndx
+                               ,AggrOptions         aggr_opts) {
+    if (col_stopndx == 0) { col_stopndx = AggrColumnCount(new_vals); }
+    if (col_startndx < 1 or col_stopndx <= col_startndx) {
+        return Status::Invalid("No columns to fold in: [", col_startndx, ", ", col_stopndx, ")");
+    }
+
+    ARROW_ASSIGN_OR_RAISE(auto latest_version, LatestVersion(dataset_key));
+    if (latest_version != base_snapshot.version) {
+        return Status::Invalid(
+             "Snapshot v", base_snapshot.version, " of [", dataset_key
+            ,"] is stale; the latest is v", latest_version
+        );
+    }
+
+    // samples are only appended, so every row (and its key) stays where it is
+    if (base_snapshot.version > 0 and not base_snapshot.row_keys->Equals(new_vals->column(0))) {
+        return Status::Invalid("Rows of [", dataset_key, "] don't match its snapshot's rows");
+    }
+
+    MeanAggr new_aggr { aggr_opts };
+    ARROW_RETURN_NOT_OK(new_aggr.Accumulate(new_vals, col_startndx, col_stopndx));
+
+    // a fresh aggregate starts out sharing the base state, and copies it before the merge
+    // updates it, so `base_snapshot` is never modified
+    AggrSnapshot next_snapshot { base_snapshot };
+    next_snapshot.version += 1;
+    next_snapshot.aggr     = MeanAggr { aggr_opts };
+    ARROW_RETURN_NOT_OK(next_snapshot.aggr.Combine(&base_snapshot.aggr));
+    ARROW_RETURN_NOT_OK(next_snapshot.aggr.Combine(&new_aggr));
+
+    if (base_snapshot.version == 0) {
+        next_snapshot.key_field = new_vals->schema()->field(0);
+        next_snapshot.row_keys  = new_vals->column(0);
+    }
+
+    ColumnRange new_range {
+         base_snapshot.NextColumn()
+        ,base_snapshot.NextColumn() + (col_stopndx - col_startndx)
+    };
+
+    // 1 range per fold, so range i is what version i + 1 added
+    next_snapshot.col_ranges.push_back(new_range);
+
+    // >> write the snapshot, then point the latest-snapshot key at it
+    ARROW_ASSIGN_OR_RAISE(
+         auto state_table
+        ,next_snapshot.aggr.StateTable(next_snapshot.key_field, next_snapshot.row_keys)
+    );
+
+    auto state_meta = state_table->schema()->metadata()->Copy();
+    ARROW_RETURN_NOT_OK(state_meta->Set(aggr_version_key, std::to_string(next_snapshot.version)));
+    ARROW_RETURN_NOT_OK(state_meta->Set(aggr_columns_key, FormatColumnRanges(next_snapshot.col_ranges)));
+
+    ARROW_RETURN_NOT_OK(store.PutPartitionData(
+         SnapshotKey(dataset_key, next_snapshot.version)
+        ,state_table->ReplaceSchemaMetadata(state_meta)
+        ,slice_rows
+    ));
+
+    auto latest_meta = std::make_shared<KVMetadata>();
+    latest_meta->Append(aggr_version_key, std::to_string(next_snapshot.version));
+
+    ARROW_ASSIGN_OR_RAISE(auto latest_table , Table::MakeEmpty(arrow::schema({}, latest_meta)));
+    ARROW_ASSIGN_OR_RAISE(auto latest_buffer, WriteTableToBuffer(latest_table));
+    ARROW_RETURN_NOT_OK(store.PutKey(LatestSnapshotKey(dataset_key), latest_buffer));
+
+    return next_snapshot;
+}
+
+Result<AggrSnapshot>
+AggrSnapshotStore::RefreshFromFile( const std::string &dataset_key
+                                   ,const std::string &path_as_uri
+                                   ,IOStrategy         io_strategy
+                                   ,AggrOptions        aggr_opts) {
+    ARROW_ASSIGN_OR_RAISE(auto base_snapshot, ReadSnapshot(dataset_key));
+    ARROW_ASSIGN_OR_RAISE(auto src_reader   , ReaderForIPCFile(path_as_uri, io_strategy));
+
+    auto    src_schema  = src_reader->schema();
+    int64_t col_count   = AggrColumnCount(*src_schema);
+    int64_t next_colndx = base_snapshot.NextColumn();
+
+    if (next_colndx > col_count) {
+        return Status::Invalid(
+             "[", path_as_uri, "] has ", col_count, " columns; the snapshot of ["
+            ,dataset_key, "] covers ", next_colndx
+        );
+    }
+
+    if (next_colndx == col_count) { return base_snapshot; }
+
+    // samples of the matrix layout are 1 column, so it is read (and decoded) whole, and
+    // only the new samples are accumulated
+    ReadProjection new_projection;
+    int64_t        col_startndx = 1;
+    if (IsMatrixLayout(*src_schema)) {
+        new_projection.col_indices = { 0, 1 };
+        col_startndx               = next_colndx;
+    }
+
+    else {
+        new_projection.col_indices = { 0 };
+        for (int64_t col_ndx = next_colndx; col_ndx < col_count; ++col_ndx) {
+            new_projection.col_indices.push_back(static_cast<int>(col_ndx));
+        }
+    }
+
+    ARROW_ASSIGN_OR_RAISE(auto new_vals, ReadIPCFile(path_as_uri, io_strategy, new_projection));
+    return FoldColumns(
+        dataset_key, base_snapshot, new_vals, col_startndx, AggrColumnCount(new_vals), aggr_opts
+    );
+}
@@ -0,0 +1,196 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#pragma once
+
+#include <atomic>
+#include <unordered_map>
+
+#include "adapter_arrow.hpp"
+#include "operators.hpp"
+
+
+// ------------------------------
+// Partition stores
+//
+// The t-test reads partitions (tables) from a key-value store. A partition under key K is
+// stored in slices: key K holds the partition's schema (with its metadata) and slice
+// count, and keys "K;0", "K;1", ... each hold a run of its rows. Every value is IPC
+// stream bytes (see `WriteTableToBuffer`). Slices keep each value small, and let a
+// partition be read with several slice reads in flight.
+//
+// Backends implement the key-value operations; reads and writes of partitions, the
+// (optional) simulated read latency and the statistics are shared.
+
+struct StoreStats {
+  int64_t                  get_count     { 0 };
+  int64_t                  put_count     { 0 };
+  int64_t                  bytes_read    { 0 };
+  int64_t                  bytes_written { 0 };
+
+  // summed over gets, so it exceeds wall time when reads overlap
+  std::chrono::nanoseconds get_time      { 0 };
+};
+
+class PartitionStore {
+  public:
+    // `get_delay` is added to every read, to stand in for a remote store's latency
+    explicit PartitionStore(std::chrono::microseconds get_delay = std::chrono::microseconds { 0 })
+      : get_delay(get_delay) {}
+
+    virtual ~PartitionStore() = default;
+
+    // >> key-value operations; safe to call from several threads
+    Result<shared_ptr<Buffer>> GetKey(const std::string &key);
+    Status                     PutKey(const std::string &key, shared_ptr<Buffer> key_val);
+    Result<bool>               HasKey(const std::string &key);
+
+    // >> partitions
+    Status
+    PutPartitionData(const std::string &key, shared_ptr<Table> table_data, int64_t slice_rows);
+
+    // read slices one at a time
+    Result<shared_ptr<Table>> GetPartitionData(const std::string &key);
+
+    // keep up to `qdepth` slice reads in flight (on as many threads)
+    Result<shared_ptr<Table>> MapPartitionData(const std::string &key, size_t qdepth);
+
+    StoreStats Stats() const;
+    void       PrintStats() const;
+
+  protected:
+    virtual Result<shared_ptr<Buffer>> ReadValue(const std::string &key) = 0;
+    virtual Status WriteValue(const std::string &key, shared_ptr<Buffer> key_val) = 0;
+    virtual Result<bool> ContainsValue(const std::string &key) = 0;
+
+  private:
+    std::chrono::microseconds get_delay;
+
+    std::atomic<int64_t> get_count     { 0 };
+    std::atomic<int64_t> put_count     { 0 };
+    std::atomic<int64_t> bytes_read    { 0 };
+    std::atomic<int64_t> bytes_written { 0 };
+    std::atomic<int64_t> get_nanos     { 0 };
+};
+
+// Each key is a file under `root_dirpath` ('/' in a key makes subdirectories). Values are
+// read into memory, as they would be from a remote store.
+class LocalDirStore : public PartitionStore {
+  public:
+    explicit LocalDirStore( std::string               root_dirpath
+                           ,std::chrono::microseconds get_delay = std::chrono::microseconds { 0 })
+      : PartitionStore(get_delay), root_dirpath(std::move(root_dirpath)) {}
+
+  protected:
+    Result<shared_ptr<Buffer>> ReadValue(const std::string &key) override;
+    Status WriteValue(const std::string &key, shared_ptr<Buffer> key_val) override;
+    Result<bool> ContainsValue(const std::string &key) override;
+
+  private:
+    std::string PathForKey(const std::string &key) const;
+
+    std::string root_dirpath;
+};
+
+// Values live in a map in this process; reads share the stored buffers
+class MemoryStore : public PartitionStore {
+  public:
+    explicit MemoryStore(std::chrono::microseconds get_delay = std::chrono::microseconds { 0 })
+      : PartitionStore(get_delay) {}
+
+  protected:
+    Result<shared_ptr<Buffer>> ReadValue(const std::string &key) override;
+    Status WriteValue(const std::string &key, shared_ptr<Buffer> key_val) override;
+    Result<bool> ContainsValue(const std::string &key) override;
+
+  private:
+    std::mutex                                          values_lock;
+    std::unordered_map<std::string, shared_ptr<Buffer>> key_values;
+};
+
+
+// ------------------------------
+// Aggregate snapshots
+//
+// A dataset's partial aggregate, kept current as samples (columns) are appended to the
+// dataset. A refresh aggregates only the columns that the latest snapshot doesn't cover,
+// merges them into it (`MeanAggr::Combine`), and stores the result as a new snapshot:
+// partition "<dataset>.aggr.v<N>", in the layout of `MeanAggr::StateTable` plus the
+// version and the column range each fold added. Then key "<dataset>.aggr" is replaced with
+// the new version. Snapshots are never modified, so a reader sees either the previous
+// snapshot or the new one, never a partial update.
+//
+// For the matrix layout, a refresh still reads the whole sample block (1 column holds every
+// sample of a row, so the new samples are interleaved with the old ones); only the
+// aggregation is limited to the new columns.
+//
+// Refreshes of a dataset must come from 1 writer at a time; a refresh based on a snapshot
+// that is no longer the latest fails, instead of losing the other refresh's columns.
+
+// Source columns [start, stop), as `MeanAggr::Accumulate` counts them
+struct ColumnRange {
+    int64_t start { 0 };
+    int64_t stop  { 0 };
+};
+
+struct AggrSnapshot {
+    int64_t                  version { 0 };  // 0: no snapshot yet; nothing is aggregated
+    MeanAggr                 aggr;
+    shared_ptr<Field>        key_field;
+    shared_ptr<ChunkedArray> row_keys;
+    std::vector<ColumnRange> col_ranges;    // range i was folded in by version i + 1
+
+    // the first source column that isn't aggregated yet
+    int64_t NextColumn() const;
+};
+
+class AggrSnapshotStore {
+  public:
+    explicit AggrSnapshotStore( PartitionStore &store
+                               ,int64_t         slice_rows = 1024
+                               ,size_t          qdepth     = 1)
+      : store(store), slice_rows(slice_rows), qdepth(qdepth) {}
+
+    Result<int64_t> LatestVersion(const std::string &dataset_key);
+
+    // `version` 0 reads the latest snapshot (or an empty one, if there are none)
+    Result<AggrSnapshot> ReadSnapshot(const std::string &dataset_key, int64_t version = 0);
+
+    // Aggregates columns [col_startndx, col_stopndx) of `new_vals` as the source columns
+    // after those `base_snapshot` covers, and stores the result as the next snapshot
+    Result<AggrSnapshot> FoldColumns( const std::string  &dataset_key
+                                     ,const AggrSnapshot &base_snapshot
+                                     ,shared_ptr<Table>   new_vals
+                                     ,int64_t             col_startndx
+                                     ,int64_t             col_stopndx
+                                     ,AggrOptions         aggr_opts = AggrOptions {});
+
+    // Reads only the key column and the columns of the file that the latest snapshot
+    // doesn't cover, then folds them in. If there are none, the latest snapshot is returned.
+    Result<AggrSnapshot> RefreshFromFile( const std::string &dataset_key
+                                         ,const std::string &path_as_uri
+                                         ,IOStrategy         io_strategy = IOStrategy::Read
+                                         ,AggrOptions        aggr_opts   = AggrOptions {});
+
+  private:
+    PartitionStore &store;
+    int64_t         slice_rows;
+    size_t          qdepth;
+};
@@ -0,0 +1,333 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "recycling_pool.hpp"
+
+
+// ------------------------------
+// Thread caches
+
+// Outlives the pool while any thread still caches its blocks; the backing pool must
+// outlive those threads (the default pool does)
+struct RecycleCacheState {
+    MemoryPool           *backing_pool;
+    std::atomic<int64_t>  cached_bytes { 0 };
+
+    explicit RecycleCacheState(MemoryPool *backing_pool) : backing_pool(backing_pool) {}
+};
+
+namespace {
+
+    constexpr int64_t
+    ClassBytes(int size_class) {
+        return int64_t { 1 } << (size_class + RecyclingMemoryPool::min_class_shift);
+    }
+
+    // 1 thread's free lists for 1 pool
+    struct PoolCache {
+        uint64_t                                                            pool_id;
+        shared_ptr<RecycleCacheState>                                       cache_state;
+        std::array<std::vector<uint8_t*>, RecyclingMemoryPool::class_count> free_blocks;
+        int64_t                                                             cached_bytes { 0 };
+
+        void Release() {
+            for (int size_class = 0; size_class < RecyclingMemoryPool::class_count; ++size_class) {
+                for (uint8_t *block : free_blocks[size_class]) {
+                    cache_state->backing_pool->Free(
+                        block, ClassBytes(size_class), arrow::kDefaultBufferAlignment
+                    );
+                }
+
+                free_blocks[size_class].clear();
+            }
+
+            cache_state->cached_bytes -= cached_bytes;
+            cached_bytes               = 0;
+        }
+    };
+
+    struct ThreadCaches {
+        std::vector<PoolCache> pool_caches;
+
+        ~ThreadCaches() {
+            for (auto &pool_cache : pool_caches) { pool_cache.Release(); }
+        }
+
+        PoolCache& ForPool(uint64_t pool_id, const shared_ptr<RecycleCacheState> &cache_state) {
+            for (auto &pool_cache : pool_caches) {
+                if (pool_cache.pool_id == pool_id) { return pool_cache; }
+            }
+
+            pool_caches.push_back(PoolCache { pool_id, cache_state, {}, 0 });
+            return pool_caches.back();
+        }
+
+        void Drop(uint64_t pool_id) {
+            auto cache_iter = std::find_if(
+                 pool_caches.begin(), pool_caches.end()
+                ,[pool_id](const PoolCache &pool_cache) { return pool_cache.pool_id == pool_id; }
+            );
+
+            if (cache_iter == pool_caches.end()) { return; }
+
+            cache_iter->Release();
+            pool_caches.erase(cache_iter);
+        }
+    };
+
+    thread_local ThreadCaches   thread_caches;
+    std::atomic<uint64_t>       next_pool_id { 1 };
+
+} // namespace
+
+
+// ------------------------------
+// Functions
+
+Result<PoolKind>
+PoolKindFromName(const std::string &pool_name) {
+    if      (pool_name == "default"  ) { return PoolKind::Default;   }
+    else if (pool_name == "recycling") { return PoolKind::Recycling; }
+
+    return Status::Invalid("Unknown memory pool: '", pool_name, "'");
+}
+
+const char*
+PoolKindName(PoolKind pool_kind) {
+    switch (pool_kind) {
+        case PoolKind::Default:   return "default";
+        case PoolKind::Recycling: return "recycling";
+    }
+
+    return "unknown";
+}
+
+
+// ------------------------------
+// Methods
+
+RecyclingMemoryPool::RecyclingMemoryPool(MemoryPool *backing_pool, int64_t thread_cache_bytes)
+  : backing_pool(backing_pool)
+   ,thread_cache_bytes(thread_cache_bytes)
+   ,pool_id(next_pool_id.fetch_add(1))
+   ,cache_state(std::make_shared<RecycleCacheState>(backing_pool)) {}
+
+RecyclingMemoryPool::~RecyclingMemoryPool() {
+    thread_caches.Drop(pool_id);
+}
+
+int
+RecyclingMemoryPool::SizeClass(int64_t size, int64_t alignment) {
+    if (size <= 0 or size > ClassBytes(class_count - 1)) { return -1; }
+    if (alignment > arrow::kDefaultBufferAlignment)      { return -1; }
+
+    // ceil(log2(size)), for size > 1
+    int size_shift = size == 1 ? 0 : 64 - __builtin_clzll(static_cast<uint64_t>(size - 1));
+    return std::max(size_shift, min_class_shift) - min_class_shift;
+}
+
+void
+RecyclingMemoryPool::DidAllocate(int64_t size) {
+    int64_t used_bytes = bytes_used.fetch_add(size) + size;
+
+    int64_t prev_peak = peak_bytes.load();
+    while (used_bytes > prev_peak and not peak_bytes.compare_exchange_weak(prev_peak, used_bytes)) {}
+
+    total_bytes += size;
+    ++alloc_count;
+}
+
+void
+RecyclingMemoryPool::DidReallocate(int64_t old_size, int64_t new_size) {
+    if (new_size > old_size) { DidAllocate(new_size - old_size); }
+    else                     { DidFree(old_size - new_size);     }
+}
+
+void
+RecyclingMemoryPool::DidFree(int64_t size) {
+    bytes_used -= size;
+}
+
+Status
+RecyclingMemoryPool::Allocate(int64_t size, int64_t alignment, uint8_t **out) {
+    int size_class = SizeClass(size, alignment);
+    if (size_class < 0) {
+        ARROW_RETURN_NOT_OK(backing_pool->Allocate(size, alignment, out));
+        DidAllocate(size);
+
+        return Status::OK();
+    }
+
+    auto &pool_cache = thread_caches.ForPool(pool_id, cache_state);
+    auto &free_list  = pool_cache.free_blocks[size_class];
+
+    if (free_list.empty()) {
+        ARROW_RETURN_NOT_OK(
+            backing_pool->Allocate(ClassBytes(size_class), arrow::kDefaultBufferAlignment, out)
+        );
+
+        ++miss_count;
+    }
+
+    else {
+        *out = free_list.back();
+        free_list.pop_back();
+
+        pool_cache.cached_bytes   -= ClassBytes(size_class);
+        cache_state->cached_bytes -= ClassBytes(size_class);
+        ++hit_count;
+    }
+
+    DidAllocate(size);
+    return Status::OK();
+}
+
+Status
+RecyclingMemoryPool::Reallocate( int64_t   old_size
+                                ,int64_t   new_size
+                                ,int64_t   alignment
+                                ,uint8_t **ptr) {
+    int old_class = SizeClass(old_size, alignment);
+    int new_class = SizeClass(new_size, alignment);
+
+    // the block already fits
+    if (old_class >= 0 and old_class == new_class) {
+        DidReallocate(old_size, new_size);
+        return Status::OK();
+    }
+
+    if (old_class < 0 and new_class < 0) {
+        ARROW_RETURN_NOT_OK(backing_pool->Reallocate(old_size, new_size, alignment, ptr));
+        DidReallocate(old_size, new_size);
+
+        return Status::OK();
+    }
+
+    // moving into or out of recycled blocks
+    uint8_t *new_block { nullptr };
+    ARROW_RETURN_NOT_OK(Allocate(new_size, alignment, &new_block));
+
+    std::memcpy(new_block, *ptr, static_cast<size_t>(std::min(old_size, new_size)));
+    Free(*ptr, old_size, alignment);
+    *ptr = new_block;
+
+    return Status::OK();
+}
+
+void
+RecyclingMemoryPool::Free(uint8_t *buffer, int64_t size, int64_t alignment) {
+    DidFree(size);
+
+    int size_class = SizeClass(size, alignment);
+    if (size_class < 0) {
+        backing_pool->Free(buffer, size, alignment);
+        return;
+    }
+
+    auto &pool_cache = thread_caches.ForPool(pool_id, cache_state);
+    if (pool_cache.cached_bytes + ClassBytes(size_class) > thread_cache_bytes) {
+        backing_pool->Free(buffer, ClassBytes(size_class), arrow::kDefaultBufferAlignment);
+        return;
+    }
+
+    pool_cache.free_blocks[size_class].push_back(buffer);
+    pool_cache.cached_bytes   += ClassBytes(size_class);
+    cache_state->cached_bytes += ClassBytes(size_class);
+}
+
+void
+RecyclingMemoryPool::ReleaseUnused() {
+    thread_caches.ForPool(pool_id, cache_state).Release();
+    backing_pool->ReleaseUnused();
+}
+
+int64_t RecyclingMemoryPool::bytes_allocated()       const { return bytes_used.load();  }
+int64_t RecyclingMemoryPool::max_memory()            const { return peak_bytes.load();  }
+int64_t RecyclingMemoryPool::total_bytes_allocated() const { return total_bytes.load(); }
+int64_t RecyclingMemoryPool::num_allocations()       const { return alloc_count.load(); }
+
+std::string
+RecyclingMemoryPool::backend_name() const {
+    return "recycling(" + backing_pool->backend_name() + ")";
+}
+
+RecycleStats
+RecyclingMemoryPool::Stats() const {
+    RecycleStats pool_stats;
+
+    pool_stats.hit_count    = hit_count.load();
+    pool_stats.miss_count   = miss_count.load();
+    pool_stats.cached_bytes = cache_state->cached_bytes.load();
+
+    return pool_stats;
+}
+
+
+// >> TimedMemoryPool
+
+void
+TimedMemoryPool::DidCall(std::chrono::steady_clock::time_point call_tstart) {
+    std::chrono::nanoseconds call_time { std::chrono::steady_clock::now() - call_tstart };
+
+    call_nanos += call_time.count();
+    ++call_count;
+}
+
+Status
+TimedMemoryPool::Allocate(int64_t size, int64_t alignment, uint8_t **out) {
+    auto call_tstart = std::chrono::steady_clock::now();
+    auto call_status = target_pool->Allocate(size, alignment, out);
+    DidCall(call_tstart);
+
+    return call_status;
+}
+
+Status
+TimedMemoryPool::Reallocate( int64_t   old_size
+                            ,int64_t   new_size
+                            ,int64_t   alignment
+                            ,uint8_t **ptr) {
+    auto call_tstart = std::chrono::steady_clock::now();
+    auto call_status = target_pool->Reallocate(old_size, new_size, alignment, ptr);
+    DidCall(call_tstart);
+
+    return call_status;
+}
+
+void
+TimedMemoryPool::Free(uint8_t *buffer, int64_t size, int64_t alignment) {
+    auto call_tstart = std::chrono::steady_clock::now();
+    target_pool->Free(buffer, size, alignment);
+    DidCall(call_tstart);
+}
+
+AllocTime
+TimedMemoryPool::Times() const {
+    AllocTime alloc_time;
+
+    alloc_time.call_count = call_count.load();
+    alloc_time.call_time  = std::chrono::nanoseconds { call_nanos.load() };
+
+    return alloc_time;
+}
@@ -0,0 +1,158 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "adapter_arrow.hpp"
+
+
+// ------------------------------
+// Memory pools
+//
+// The vectorized (compute function) kernels allocate a new output buffer for every
+// intermediate, e.g. 8 float64 columns per sample when accumulating a mean and variance,
+// and free it moments later. A `RecyclingMemoryPool` keeps freed buffers on free lists of
+// the freeing thread, by size class (powers of 2), and hands them out again to allocations
+// of the same class from that thread. Every size class is a separate allocation from the
+// backing pool, so blocks are rounded up to a power of 2: up to 2x the memory of the
+// requested sizes.
+//
+// Pass it to compute functions via an `arrow::compute::ExecContext` (see
+// `AggrOptions::exec_ctx`). Buffers from it must be released before it is destroyed.
+//
+// A `TimedMemoryPool` wraps either kind of pool and adds up the time spent in it, so that
+// the time a recycling pool saves can be compared against the default pool.
+
+// free-list bytes of a pool, shared with the threads that cache its blocks
+struct RecycleCacheState;
+
+enum class PoolKind { Default, Recycling };
+
+Result<PoolKind> PoolKindFromName(const std::string &pool_name);
+const char*      PoolKindName(PoolKind pool_kind);
+
+struct RecycleStats {
+    int64_t hit_count    { 0 };  // allocations served from a free list
+    int64_t miss_count   { 0 };  // allocations passed to the backing pool
+    int64_t cached_bytes { 0 };  // bytes on the free lists (of all threads)
+};
+
+class RecyclingMemoryPool : public MemoryPool {
+  public:
+    // >> blocks of 64 B (class 0) up to 1 GiB; larger allocations aren't recycled
+    static constexpr int     min_class_shift     { 6  };
+    static constexpr int     max_class_shift     { 30 };
+    static constexpr int     class_count         { max_class_shift - min_class_shift + 1 };
+
+    static constexpr int64_t default_cache_bytes { int64_t { 256 } << 20 };
+
+    // `thread_cache_bytes` limits the bytes each thread keeps on its free lists; blocks
+    // freed beyond it go back to `backing_pool`
+    explicit RecyclingMemoryPool( MemoryPool *backing_pool       = arrow::default_memory_pool()
+                                 ,int64_t     thread_cache_bytes = default_cache_bytes);
+
+    // returns the calling thread's cached blocks to the backing pool. Blocks that other
+    // threads cached are returned when those threads exit.
+    ~RecyclingMemoryPool() override;
+
+    RecyclingMemoryPool(const RecyclingMemoryPool &)            = delete;
+    RecyclingMemoryPool &operator=(const RecyclingMemoryPool &) = delete;
+
+    using MemoryPool::Allocate;
+    using MemoryPool::Reallocate;
+    using MemoryPool::Free;
+
+    Status Allocate(int64_t size, int64_t alignment, uint8_t **out) override;
+    Status Reallocate(int64_t old_size, int64_t new_size, int64_t alignment, uint8_t **ptr) override;
+    void   Free(uint8_t *buffer, int64_t size, int64_t alignment) override;
+
+    // returns the calling thread's cached blocks to the backing pool
+    void ReleaseUnused() override;
+
+    // >> as for any pool: bytes held by callers (by requested size), not cached bytes
+    int64_t     bytes_allocated()       const override;
+    int64_t     max_memory()            const override;
+    int64_t     total_bytes_allocated() const override;
+    int64_t     num_allocations()       const override;
+    std::string backend_name()          const override;
+
+    RecycleStats Stats() const;
+
+  private:
+    // size class of an allocation, or -1 if it isn't recycled
+    static int SizeClass(int64_t size, int64_t alignment);
+
+    void DidAllocate(int64_t size);
+    void DidReallocate(int64_t old_size, int64_t new_size);
+    void DidFree(int64_t size);
+
+    MemoryPool                    *backing_pool;
+    int64_t                        thread_cache_bytes;
+    uint64_t                       pool_id;
+    shared_ptr<RecycleCacheState>  cache_state;
+
+    std::atomic<int64_t> bytes_used   { 0 };
+    std::atomic<int64_t> peak_bytes   { 0 };
+    std::atomic<int64_t> total_bytes  { 0 };
+    std::atomic<int64_t> alloc_count  { 0 };
+    std::atomic<int64_t> hit_count    { 0 };
+    std::atomic<int64_t> miss_count   { 0 };
+};
+
+
+struct AllocTime {
+    int64_t                  call_count { 0 };  // allocations, reallocations and frees
+    std::chrono::nanoseconds call_time  { 0 };  // wall time spent in them
+};
+
+// Forwards to `target_pool`, timing every allocation, reallocation and free
+class TimedMemoryPool : public MemoryPool {
+  public:
+    explicit TimedMemoryPool(MemoryPool *target_pool) : target_pool(target_pool) {}
+
+    using MemoryPool::Allocate;
+    using MemoryPool::Reallocate;
+    using MemoryPool::Free;
+
+    Status Allocate(int64_t size, int64_t alignment, uint8_t **out) override;
+    Status Reallocate(int64_t old_size, int64_t new_size, int64_t alignment, uint8_t **ptr) override;
+    void   Free(uint8_t *buffer, int64_t size, int64_t alignment) override;
+
+    void ReleaseUnused() override { target_pool->ReleaseUnused(); }
+
+    int64_t     bytes_allocated()       const override { return target_pool->bytes_allocated();       }
+    int64_t     max_memory()            const override { return target_pool->max_memory();            }
+    int64_t     total_bytes_allocated() const override { return target_pool->total_bytes_allocated(); }
+    int64_t     num_allocations()       const override { return target_pool->num_allocations();       }
+    std::string backend_name()          const override { return target_pool->backend_name();          }
+
+    AllocTime Times() const;
+
+  private:
+    void DidCall(std::chrono::steady_clock::time_point call_tstart);
+
+    MemoryPool *target_pool;
+
+    std::atomic<int64_t> call_count { 0 };
+    std::atomic<int64_t> call_nanos { 0 };
+};
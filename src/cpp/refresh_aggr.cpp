@@ -0,0 +1,173 @@
+// ------------------------------
+// LICENSE
+//
+// Copyright 2024 Aldrin Montana
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// ------------------------------
+// Dependencies
+#include <getopt.h>
+
+#include "experiments.hpp"
+
+
+// ------------------------------
+// Variables
+
+static std::string help_message {
+    "Usage: <refresher> [options] <path-to-store> <dataset-key> <path-to-feather>\n"
+    "\tFolds the samples (columns) of a feather file that the dataset's latest aggregate\n"
+    "\tsnapshot doesn't cover into a new snapshot; only those columns are read. Samples\n"
+    "\tmust only ever be appended to the file.\n"
+    "Options:\n"
+    "\t-s, --slice-rows <N>: rows per slice of each snapshot (default: 1024)\n"
+    "\t-k, --kernel <name> : aggregation kernel: vec, fused, tiled or arrow (default: fused);\n"
+    "\t                      a file of the matrix layout has only the fused kernel\n"
+    "\t-v, --verify        : also aggregate every column of the file, and print the max abs\n"
+    "\t                      difference from the snapshot"
+};
+
+static const char *option_template = "s:k:v";
+
+static const struct option option_longnames[] = {
+     { "slice-rows", required_argument, nullptr, 's' }
+    ,{ "kernel"    , required_argument, nullptr, 'k' }
+    ,{ "verify"    , no_argument      , nullptr, 'v' }
+    ,{ nullptr     , 0                , nullptr,  0  }
+};
+
+
+// ------------------------------
+// Functions
+
+// Largest difference between `snapshot` and a from-scratch aggregate of the whole file
+static Status
+PrintSnapshotDiff(const AggrSnapshot &snapshot, const std::string &src_uri, AggrOptions aggr_opts) {
+    ARROW_ASSIGN_OR_RAISE(auto src_table, ReadIPCFile(src_uri));
+
+    MeanAggr full_aggr { aggr_opts };
+    ARROW_RETURN_NOT_OK(full_aggr.Accumulate(src_table));
+
+    for (auto state_cols : { std::make_pair(full_aggr.means    , snapshot.aggr.means    )
+                            ,std::make_pair(full_aggr.variances, snapshot.aggr.variances) }) {
+        ARROW_ASSIGN_OR_RAISE(
+             auto state_diff
+            ,arrow::compute::CallFunction("abs", { VecSub(state_cols.first, state_cols.second) })
+        );
+
+        ARROW_ASSIGN_OR_RAISE(auto diff_range, arrow::compute::MinMax(state_diff));
+        std::cout << "\tmax abs difference (" << state_cols.first->type()->ToString() << "): "
+                  << diff_range.scalar_as<arrow::StructScalar>().value[1]->ToString()
+                  << std::endl
+        ;
+    }
+
+    std::cout << "\tsample counts: " << full_aggr.count << " (full), "
+                                     << snapshot.aggr.count << " (snapshot)"
+              << std::endl
+    ;
+
+    return Status::OK();
+}
+
+int main(int argc, char **argv) {
+    // ----------
+    // Process CLI options, then positional args
+    int64_t     slice_rows   { 1024  };
+    bool        should_check { false };
+    AggrOptions aggr_opts;
+
+    char parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    while (parsed_opt != (char) -1) {
+        switch (parsed_opt) {
+            case 's': { slice_rows   = std::stoll(optarg); break; }
+            case 'v': { should_check = true;               break; }
+
+            case 'k': {
+                auto kernel_result = AggrKernelFromName(optarg);
+                if (not kernel_result.ok()) {
+                    std::cerr << "Error: " << kernel_result.status().message() << std::endl
+                              << help_message                                  << std::endl
+                    ;
+                    return 1;
+                }
+
+                aggr_opts.kernel = *kernel_result;
+                break;
+            }
+
+            default: {
+                std::cerr << help_message << std::endl;
+                return 1;
+            }
+        }
+
+        parsed_opt = (char) getopt_long(argc, argv, option_template, option_longnames, nullptr);
+    }
+
+    if (argc - optind != 3 or slice_rows <= 0) {
+      std::cerr << "Error: expected 3 arguments and a positive slice size." << std::endl
+                << help_message                                             << std::endl
+      ;
+      return 1;
+    }
+
+    std::string dataset_key { argv[optind + 1] };
+    std::string src_uri     { UriForPath(argv[optind + 2]) };
+
+    LocalDirStore     store          { argv[optind] };
+    AggrSnapshotStore snapshot_store { store, slice_rows };
+
+    auto refresh_tstart = std::chrono::steady_clock::now();
+    auto refresh_result = snapshot_store.RefreshFromFile(
+        dataset_key, src_uri, IOStrategy::Read, aggr_opts
+    );
+    MillisDouble refresh_ttime { std::chrono::steady_clock::now() - refresh_tstart };
+
+    if (not refresh_result.ok()) {
+      std::cerr << "Couldn't refresh aggregate:"              << std::endl
+                << "\t" << refresh_result.status().ToString() << std::endl
+      ;
+
+      return 2;
+    }
+
+    auto snapshot = *refresh_result;
+    std::cout << "Snapshot v" << snapshot.version << " of [" << dataset_key << "]: "
+              << snapshot.aggr.count << " samples, refreshed in "
+              << refresh_ttime.count() << "ms" << std::endl;
+
+    // the columns each version folded in
+    for (size_t range_ndx = 0; range_ndx < snapshot.col_ranges.size(); ++range_ndx) {
+        const auto &col_range = snapshot.col_ranges[range_ndx];
+        std::cout << "\tv" << range_ndx + 1 << ": columns ["
+                  << col_range.start << ", " << col_range.stop << ")" << std::endl;
+    }
+
+    store.PrintStats();
+
+    if (should_check) {
+        auto check_status = PrintSnapshotDiff(snapshot, src_uri, aggr_opts);
+        if (not check_status.ok()) {
+          std::cerr << "Couldn't verify snapshot:"   << std::endl
+                    << "\t" << check_status.ToString() << std::endl
+          ;
+
+          return 3;
+        }
+    }
+
+    return 0;
+}
@@ -20,154 +20,264 @@
 
 #include <unistd.h>
 
-#include "operators.hpp"
+#include <arrow/util/thread_pool.h>
+
+#include "experiments.hpp"
 
 using std::string;
-using Skytether::Partition;
 
 
 // ------------------------------
 // Globals
 
-const char *option_template = "l:r:o:d:h:q:";
+const char *option_template = "l:r:o:d:s:w:q:c:j:v";
+
+// datasets of metacluster 12 (left) and 13 (right), unless -l and -r are given
+const char *default_left_datasets  = "E-GEOD-100618,E-GEOD-76312";
+const char *default_right_datasets = "E-GEOD-106540";
 
 
 // ------------------------------
-// Functions
+// Classes and structs
 
-Status
-RunMappedTTest(KineticConn &kconn, uint8_t qdepth, string result_key) {
-    std::cout << "Running T-test for metaclusters 12 and 13!" << std::endl;
+// One side of the t-test: the partial aggregates of its datasets, merged as they arrive
+struct SideAggr {
+    std::vector<string> dataset_names;
+    std::mutex          merge_lock;
+    MeanAggr            merged_aggr;
+};
 
-    // ----------
-    // >> Get the gene order to normalize to
-    std::cout << "Reading gene annotations from kinetic..." << std::endl;
-    ARROW_ASSIGN_OR_RAISE(auto gene_partition, kconn.GetPartitionData("annotations/genes"));
-    ARROW_ASSIGN_OR_RAISE(auto gene_table, gene_partition->AsTable());
-    auto gene_order = gene_table->column(0);
+// How long a dataset spent being fetched, and being aligned
+struct DatasetTime {
+    string       dataset_name;
+    MillisDouble fetch_time { 0 };
+    MillisDouble align_time { 0 };
+};
 
-    // release gene table data
-    // gene_table.reset();
 
-    // ----------
-    // >> Get data for metacluster 12
-    std::cout << "Calculating partial aggregates for metacluster 12" << std::endl;
-    MeanAggr left_aggr;
+// ------------------------------
+// Functions
 
-    // Prep the first statistics
-    //      |> E-GEOD-100618
-    std::string left_meta1     { "E-GEOD-100618" };
-    // std::string left_meta1_key { "/" + left_meta1 };
-    std::string left_meta1_key { kconn.kinetic_domain->domain_key + "/" + left_meta1 };
+/**
+ * Fetch a dataset's partial aggregate, align it to the gene annotations, then merge it
+ * into its side. Merges are serialized per side, in whatever order datasets finish; the
+ * merge is order independent up to floating point rounding. With `check_gather`, the
+ * aligned table is also compared with the reference gather (`TakeAlignedRows`).
+ */
+static Status
+AlignAndMergeDataset( PartitionStore       &store
+                     ,const string         &part_key
+                     ,size_t                qdepth
+                     ,const GeneDictionary &gene_dict
+                     ,AlignmentCache       &align_cache
+                     ,SideAggr             *side_aggr
+                     ,DatasetTime          *dataset_time
+                     ,bool                  check_gather) {
+    auto fetch_tstart = std::chrono::steady_clock::now();
+    ARROW_ASSIGN_OR_RAISE(auto part_table, store.MapPartitionData(part_key, qdepth));
+    auto fetch_tstop  = std::chrono::steady_clock::now();
+
+    ARROW_ASSIGN_OR_RAISE(auto part_order, gene_dict.OrderFor(*part_table));
+    ARROW_ASSIGN_OR_RAISE(auto part_norm , CopyMatchedRows(part_order, part_table, align_cache));
+
+    if (check_gather) {
+        ARROW_ASSIGN_OR_RAISE(auto gather_ndxs, AlignRowsByKey(part_order, part_table->column(0)));
+        ARROW_ASSIGN_OR_RAISE(auto take_norm  , TakeAlignedRows(part_table, gather_ndxs, part_order));
+
+        if (not part_norm->Equals(*take_norm)) {
+            return Status::Invalid("Aligned rows of [", part_key, "] differ from the reference gather");
+        }
+    }
 
-    std::cout << "\t" << left_meta1     << std::endl;
-    ARROW_ASSIGN_OR_RAISE(auto left_meta1_table, kconn.MapPartitionData(left_meta1_key, qdepth));
-    ARROW_ASSIGN_OR_RAISE(auto left_meta1_norm, CopyMatchedRows(gene_order, left_meta1_table));
+    ARROW_ASSIGN_OR_RAISE(auto part_aggr, MeanAggr::FromStateTable(part_norm));
 
-    // replace the old means and variances structures
-    left_aggr.means     = std::move(left_meta1_norm->column(1));
-    left_aggr.variances = std::move(left_meta1_norm->column(2));
+    auto align_tstop  = std::chrono::steady_clock::now();
 
-    auto left_meta1_kvmeta = left_meta1_table->schema()->metadata()->Copy();
-    ARROW_ASSIGN_OR_RAISE(left_aggr.count, Skytether::GetAggrCount(left_meta1_kvmeta));
+    dataset_time->fetch_time = fetch_tstop - fetch_tstart;
+    dataset_time->align_time = align_tstop - fetch_tstop;
 
-    // release unneeded pointers
-    /*
-    left_meta1_kvmeta.reset();
-    left_meta1_table.reset();
-    left_meta1_norm.reset();
-    */
+    std::lock_guard<std::mutex> merge_guard { side_aggr->merge_lock };
+    return side_aggr->merged_aggr.Combine(&part_aggr);
+}
+
+// "Metacluster 12" for the default datasets of a side; otherwise the side and its datasets,
+// e.g. "left [E-GEOD-100618, E-GEOD-76312]"
+static string
+SideLabel( const string              &side_name
+          ,const std::vector<string> &dataset_names
+          ,const char                *default_datasets
+          ,const string              &default_label) {
+    auto default_names = SplitList(default_datasets);
+    if (default_names.ok() and *default_names == dataset_names) { return default_label; }
+
+    string side_label = side_name + " [";
+    for (size_t name_ndx = 0; name_ndx < dataset_names.size(); ++name_ndx) {
+        if (name_ndx > 0) { side_label += ", "; }
+        side_label += dataset_names[name_ndx];
+    }
 
+    return side_label + "]";
+}
 
-    //      |> E-GEOD-76312
-    MeanAggr    temp_aggr;
-    std::string left_meta2     { "E-GEOD-76312" };
-    // std::string left_meta2_key { "/" + left_meta2 };
-    std::string left_meta2_key { kconn.kinetic_domain->domain_key + "/" + left_meta2 };
+/**
+ * Every dataset (of both sides) is fetched, aligned and merged as its own task on a pool
+ * of `task_count` threads, so the wall time approaches that of the slowest dataset rather
+ * than the sum over datasets. The pool is separate from arrow's IO and CPU pools, since
+ * tasks block on reads that use those pools.
+ */
+Status
+RunMappedTTest( PartitionStore      &store
+               ,string               domain_key
+               ,uint8_t              qdepth
+               ,string               result_key
+               ,AlignmentCache      &align_cache
+               ,std::vector<string>  left_datasets
+               ,std::vector<string>  right_datasets
+               ,int                  task_count
+               ,bool                 check_kernels) {
+    // name each side by its datasets; the default sides are metaclusters 12 and 13
+    string left_label  = SideLabel("left" , left_datasets , default_left_datasets , "Metacluster 12");
+    string right_label = SideLabel("right", right_datasets, default_right_datasets, "Metacluster 13");
+
+    std::cout << "Running T-test for " << left_label << " and " << right_label << "!" << std::endl;
 
-    std::cout << "\t" << left_meta2 << std::endl;
-    ARROW_ASSIGN_OR_RAISE(auto left_meta2_table, kconn.MapPartitionData(left_meta2_key, qdepth));
-    ARROW_ASSIGN_OR_RAISE(auto left_meta2_norm, CopyMatchedRows(gene_order, left_meta2_table));
+    // ----------
+    // >> Get the gene order to normalize to
+    std::cout << "Reading gene annotations from the partition store..." << std::endl;
+    ARROW_ASSIGN_OR_RAISE(auto gene_table, store.GetPartitionData("annotations/genes"));
+    // partitions may key rows by gene ID, or by gene code into this table
+    ARROW_ASSIGN_OR_RAISE(auto gene_dict, GeneDictionary::FromTable(gene_table));
 
-    // replace the old means and variances structures
-    temp_aggr.means     = std::move(left_meta2_norm->column(1));
-    temp_aggr.variances = std::move(left_meta2_norm->column(2));
+    // ----------
+    // >> Fetch, align and merge partial aggregates of every dataset concurrently
+    SideAggr left_aggr;
+    SideAggr right_aggr;
+    left_aggr.dataset_names  = std::move(left_datasets);
+    right_aggr.dataset_names = std::move(right_datasets);
+
+    size_t dataset_count = left_aggr.dataset_names.size() + right_aggr.dataset_names.size();
+    std::vector<DatasetTime>     dataset_times(dataset_count);
+    std::vector<arrow::Future<>> dataset_futures;
+
+    if (task_count <= 0) { task_count = static_cast<int>(dataset_count); }
+    ARROW_ASSIGN_OR_RAISE(auto task_pool, arrow::internal::ThreadPool::Make(task_count));
+
+    // bytes read by the merge only, not the gene annotations read before it
+    auto merge_startstats = store.Stats();
+    auto merge_tstart     = std::chrono::steady_clock::now();
+    for (auto *side_aggr : { &left_aggr, &right_aggr }) {
+        for (const auto &dataset_name : side_aggr->dataset_names) {
+            auto *dataset_time         = &dataset_times[dataset_futures.size()];
+            dataset_time->dataset_name = dataset_name;
+
+            ARROW_ASSIGN_OR_RAISE(
+                 auto dataset_future
+                ,task_pool->Submit(
+                    [&store, &gene_dict, &align_cache, side_aggr, dataset_time, domain_key, qdepth, check_kernels]() {
+                        return AlignAndMergeDataset(
+                             store
+                            ,domain_key + "/" + dataset_time->dataset_name
+                            ,qdepth
+                            ,gene_dict
+                            ,align_cache
+                            ,side_aggr
+                            ,dataset_time
+                            ,check_kernels
+                        );
+                    }
+                 )
+            );
+
+            dataset_futures.push_back(std::move(dataset_future));
+        }
+    }
 
-    auto left_meta2_kvmeta = left_meta2_table->schema()->metadata()->Copy();
-    ARROW_ASSIGN_OR_RAISE(temp_aggr.count, Skytether::GetAggrCount(left_meta2_kvmeta));
-    // left_meta2_kvmeta.reset();
+    ARROW_RETURN_NOT_OK(arrow::AllFinished(dataset_futures).status());
+    MillisDouble merge_ttime { std::chrono::steady_clock::now() - merge_tstart };
+    int64_t      merge_bytes { store.Stats().bytes_read - merge_startstats.bytes_read };
 
-    // Merge aggregates into `left_aggr`
-    left_aggr.Combine(&temp_aggr);
+    std::cout << left_label << " aggr dimensions: " << std::endl
+              << "\trows: " << left_aggr.merged_aggr.means->length()
+              << std::endl
+    ;
 
-    // release unneeded pointers
-    /*
-    left_meta2_table.reset();
-    left_meta2_norm.reset();
-    */
-    // delete temp_aggr;
+    std::cout << right_label << " aggr dimensions: " << std::endl
+              << "\trows: " << right_aggr.merged_aggr.means->length()
+              << std::endl
+    ;
 
-    /*
     std::cout << "left aggregates:" << std::endl;
-    left_aggr.PrintState();
-    left_aggr.PrintM1M2();
-    */
+    ARROW_RETURN_NOT_OK(left_aggr.merged_aggr.PrintState());
 
-    // >> Get data for metacluster 13
-    // Prep the second statistics
-    std::cout << "Calculating partial aggregates for metacluster 13" << std::endl;
-    MeanAggr    right_aggr;
-    std::string right_meta     { "E-GEOD-106540" };
-    // std::string right_meta_key { "/" + right_meta };
-    std::string right_meta_key { kconn.kinetic_domain->domain_key + "/" + right_meta };
+    std::cout << "right aggregates:" << std::endl;
+    ARROW_RETURN_NOT_OK(right_aggr.merged_aggr.PrintState());
 
-    std::cout << "\t" << right_meta << std::endl;
-    ARROW_ASSIGN_OR_RAISE(auto right_meta_table, kconn.MapPartitionData(right_meta_key, qdepth));
-    ARROW_ASSIGN_OR_RAISE(auto right_meta_norm, CopyMatchedRows(gene_order, right_meta_table));
+    auto tstat_tstart = std::chrono::steady_clock::now();
+    auto tstat        = left_aggr.merged_aggr.ComputeTStatWith(right_aggr.merged_aggr);
+    MillisDouble tstat_ttime { std::chrono::steady_clock::now() - tstat_tstart };
 
-    // replace the old means and variances structures
-    right_aggr.means     = std::move(right_meta_norm->column(1));
-    right_aggr.variances = std::move(right_meta_norm->column(2));
+    if (tstat == nullptr) { return Status::Invalid("Couldn't compute t-statistics"); }
 
-    auto right_meta_kvmeta = right_meta_table->schema()->metadata()->Copy();
-    ARROW_ASSIGN_OR_RAISE(right_aggr.count, Skytether::GetAggrCount(right_meta_kvmeta));
-    // right_meta_kvmeta.reset();
+    // >> Recompute with the reference (vec) kernel; report its time and largest difference
+    if (check_kernels) {
+        auto vec_tstart = std::chrono::steady_clock::now();
+        auto vec_tstat  = left_aggr.merged_aggr.ComputeTStatVec(right_aggr.merged_aggr);
+        MillisDouble vec_ttime { std::chrono::steady_clock::now() - vec_tstart };
 
-    // release unneded pointers
-    /*
-    right_meta_table.reset();
-    right_meta_norm.reset();
-    */
+        if (vec_tstat == nullptr) {
+            return Status::Invalid("Couldn't compute reference t-statistics");
+        }
 
-    std::cout << "Metacluster 12 aggr dimensions: " << std::endl
-              << "\trows: " << left_aggr.means->length()
-              << std::endl
-    ;
+        ARROW_ASSIGN_OR_RAISE(
+             auto tstat_diff
+            ,arrow::compute::CallFunction(
+                "abs", { VecSub(tstat->column(0), vec_tstat->column(0)) }
+             )
+        );
 
-    std::cout << "Metacluster 13 aggr dimensions: " << std::endl
-              << "\trows: " << right_aggr.means->length()
-              << std::endl
-    ;
+        ARROW_ASSIGN_OR_RAISE(auto diff_range, arrow::compute::MinMax(tstat_diff));
+        auto max_diff = diff_range.scalar_as<arrow::StructScalar>().value[1];
 
-    std::cout << "left aggregates:" << std::endl;
-    left_aggr.PrintState();
-    // left_aggr.PrintM1M2();
+        std::cout << "T-statistic kernels:" << std::endl
+                  << "\tfused: " << tstat_ttime.count() << "ms" << std::endl
+                  << "\tvec  : " << vec_ttime.count()   << "ms" << std::endl
+                  << "\tmax abs difference: " << max_diff->ToString() << std::endl
+        ;
+    }
 
-    std::cout << "right aggregates:" << std::endl;
-    right_aggr.PrintState();
-    // right_aggr.PrintM1M2();
+    if (not result_key.empty()) {
+        ARROW_ASSIGN_OR_RAISE(auto table_buffer, WriteTableToBuffer(tstat));
+        ARROW_RETURN_NOT_OK(store.PutKey(result_key, table_buffer));
+    }
 
-    auto tstat = left_aggr.ComputeTStatWith(right_aggr);
+    // ----------
+    // >> Timing: per dataset, and wall time vs the sum over datasets
+    MillisDouble dataset_ttime { 0 };
+    std::cout << "Dataset times (qdepth " << std::to_string(qdepth) << "):" << std::endl;
+    for (const auto &dataset_time : dataset_times) {
+        std::cout << "\t" << dataset_time.dataset_name
+                  << ": fetch " << dataset_time.fetch_time.count() << "ms"
+                  << ", align " << dataset_time.align_time.count() << "ms"
+                  << std::endl
+        ;
 
-    // release unneeded data
-    // delete left_aggr;
-    // delete right_aggr;
+        dataset_ttime += dataset_time.fetch_time + dataset_time.align_time;
+    }
 
-    ARROW_ASSIGN_OR_RAISE(auto table_buffer, WriteTableToBuffer(tstat));
-    ARROW_RETURN_NOT_OK(kconn.PutKey(result_key, table_buffer));
+    std::cout << "Fetched, aligned and merged " << dataset_count << " datasets in "
+              << merge_ttime.count() << "ms (sum over datasets: "
+              << dataset_ttime.count() << "ms, "
+              << (merge_bytes / 1048576.0) / (merge_ttime.count() / 1000.0) << " MiB/s)"
+              << std::endl
+    ;
 
-    kconn.PrintStats();
-    kconn.Disconnect();
+    std::cout << "Alignment cache: "
+              << align_cache.hit_count()  << " hits, "
+              << align_cache.miss_count() << " misses"
+              << std::endl
+    ;
+
+    store.PrintStats();
 
     return Status::OK();
 }
@@ -183,11 +293,14 @@ int main(int argc, char **argv) {
     }
     */
 
-    string  domain_name, tablekey_one, tablekey_two, resultkey;
-    string  host   { "10.23.89.4" };
-    string  port   { "8123"       };
-    string  passwd { "asdfasdf"   };
-    uint8_t qdepth { 16           };
+    string  domain_name, resultkey, store_dirpath;
+    string  tablekey_one { default_left_datasets  };
+    string  tablekey_two { default_right_datasets };
+    string  cache        { "align-cache"          };
+    uint8_t qdepth       { 16                     };
+    int     delay        { 0                      };
+    int     task_count   { 0                      };
+    bool    check_kernels{ false                  };
 
     auto run_status = Status::OK();
 
@@ -214,8 +327,28 @@ int main(int argc, char **argv) {
                 break;
             }
 
-            case 'h': {
-                host = string { optarg };
+            case 's': {
+                store_dirpath = string { optarg };
+                break;
+            }
+
+            case 'w': {
+                delay = std::stoi(optarg);
+                break;
+            }
+
+            case 'c': {
+                cache = string { optarg };
+                break;
+            }
+
+            case 'j': {
+                task_count = std::stoi(optarg);
+                break;
+            }
+
+            case 'v': {
+                check_kernels = true;
                 break;
             }
 
@@ -236,17 +369,26 @@ int main(int argc, char **argv) {
 
     if (not run_status.ok()) { return 1; }
 
-    KineticConn kconn { domain_name };
-    kconn.Connect(host, port, passwd);
-    if (not kconn.IsConnected()) {
-        std::cerr << "Could not connect to kinetic" << std::endl;
+    if (store_dirpath.empty()) {
+        std::cerr << "Expected a partition store directory (-s)" << std::endl;
         return 1;
     }
-    else {
-        std::cout << "Connected to host [" << host << "]" << std::endl;
+
+    LocalDirStore store { store_dirpath, std::chrono::microseconds { delay } };
+    std::cout << "Using partition store [" << store_dirpath << "]" << std::endl;
+
+    auto left_datasets  = SplitList(tablekey_one);
+    auto right_datasets = SplitList(tablekey_two);
+    if (not left_datasets.ok() or not right_datasets.ok()) {
+        std::cerr << "Expected at least 1 dataset per side (-l, -r)" << std::endl;
+        return 1;
     }
 
-    run_status = RunMappedTTest(kconn, qdepth, resultkey);
+    AlignmentCache align_cache { cache };
+    run_status = RunMappedTTest(
+         store, domain_name, qdepth, resultkey, align_cache
+        ,*left_datasets, *right_datasets, task_count, check_kernels
+    );
     if (not run_status.ok()) {
         std::cout << "Error status:"              << std::endl
                   << "\t" << run_status.message() << std::endl
@@ -18,6 +18,13 @@
 
 // ------------------------------
 // Dependencies
+#include <cstdio>
+#include <limits>
+#include <filesystem>
+#include <unistd.h>
+
+#include <arrow/util/hashing.h>
+
 #include "experiments.hpp"
 #include "util_arrow.hpp"
 
@@ -42,13 +49,13 @@ VecToArrow(const vector<ElementType> &src_data) {
 }
 
 
-// >> Convenience wrappers
+// >> Convenience wrappers; a null `exec_ctx` uses arrow's default context (and memory pool)
 
 shared_ptr<ChunkedArray>
-VecAdd(shared_ptr<ChunkedArray> left_op, Datum right_op) {
+VecAdd(shared_ptr<ChunkedArray> left_op, Datum right_op, ExecContext *exec_ctx) {
   if (left_op == nullptr or right_op.kind() == Datum::NONE) { return nullptr; }
 
-  Result<Datum> op_result = Add(left_op, right_op);
+  Result<Datum> op_result = Add(left_op, right_op, ArithmeticOptions {}, exec_ctx);
   if (not op_result.ok()) { return nullptr; }
 
   return std::move(op_result).ValueOrDie().chunked_array();
@@ -56,10 +63,10 @@ VecAdd(shared_ptr<ChunkedArray> left_op, Datum right_op) {
 
 
 shared_ptr<ChunkedArray>
-VecSub(shared_ptr<ChunkedArray> left_op, Datum right_op) {
+VecSub(shared_ptr<ChunkedArray> left_op, Datum right_op, ExecContext *exec_ctx) {
   if (left_op == nullptr or right_op.kind() == Datum::NONE) { return nullptr; }
 
-  Result<Datum> op_result = Subtract(left_op, right_op);
+  Result<Datum> op_result = Subtract(left_op, right_op, ArithmeticOptions {}, exec_ctx);
   if (not op_result.ok()) { return nullptr; }
 
   return std::move(op_result).ValueOrDie().chunked_array();
@@ -67,10 +74,10 @@ VecSub(shared_ptr<ChunkedArray> left_op, Datum right_op) {
 
 
 shared_ptr<ChunkedArray>
-VecDiv(shared_ptr<ChunkedArray> left_op, Datum right_op) {
+VecDiv(shared_ptr<ChunkedArray> left_op, Datum right_op, ExecContext *exec_ctx) {
   if (left_op == nullptr) { return nullptr; }
 
-  Result<Datum> op_result = Divide(left_op, right_op);
+  Result<Datum> op_result = Divide(left_op, right_op, ArithmeticOptions {}, exec_ctx);
   if (not op_result.ok()) { return nullptr; }
 
   return std::move(op_result).ValueOrDie().chunked_array();
@@ -78,10 +85,10 @@ VecDiv(shared_ptr<ChunkedArray> left_op, Datum right_op) {
 
 
 shared_ptr<ChunkedArray>
-VecMul(shared_ptr<ChunkedArray> left_op, Datum right_op) {
+VecMul(shared_ptr<ChunkedArray> left_op, Datum right_op, ExecContext *exec_ctx) {
   if (left_op == nullptr) { return nullptr; }
 
-  Result<Datum> op_result = Multiply(left_op, right_op);
+  Result<Datum> op_result = Multiply(left_op, right_op, ArithmeticOptions {}, exec_ctx);
   if (not op_result.ok()) { return nullptr; }
 
   return std::move(op_result).ValueOrDie().chunked_array();
@@ -89,215 +96,911 @@ VecMul(shared_ptr<ChunkedArray> left_op, Datum right_op) {
 
 
 shared_ptr<ChunkedArray>
-VecPow(shared_ptr<ChunkedArray> left_op, Datum right_op) {
+VecPow(shared_ptr<ChunkedArray> left_op, Datum right_op, ExecContext *exec_ctx) {
   if (left_op == nullptr) { return nullptr; }
 
-  Result<Datum> op_result = Power(left_op, right_op);
+  Result<Datum> op_result = Power(left_op, right_op, ArithmeticOptions {}, exec_ctx);
   if (not op_result.ok()) { return nullptr; }
 
   return std::move(op_result).ValueOrDie().chunked_array();
 }
 
 
-// TODO: eventually decompose this so that each chunk can be individually updated
+/**
+ * Compare 2 tables of float64 columns (e.g. aggregate results) element-wise and return the
+ * largest absolute difference across all columns. Tables must have the same shape.
+ */
+Result<double>
+MaxAbsDifference(shared_ptr<Table> left_table, shared_ptr<Table> right_table) {
+    if (   left_table->num_columns() != right_table->num_columns()
+        or left_table->num_rows()    != right_table->num_rows()) {
+        return Status::Invalid("Cannot compare tables with different dimensions");
+    }
+
+    double max_diff = 0;
+    for (int col_ndx = 0; col_ndx < left_table->num_columns(); ++col_ndx) {
+        ARROW_ASSIGN_OR_RAISE(
+             Datum col_diff
+            ,Subtract(left_table->column(col_ndx), right_table->column(col_ndx))
+        );
+
+        ARROW_ASSIGN_OR_RAISE(Datum abs_diff, AbsoluteValue(col_diff));
+        ARROW_ASSIGN_OR_RAISE(Datum minmax  , MinMax(abs_diff));
+
+        auto col_max = minmax.scalar_as<arrow::StructScalar>().value[1];
+        if (not col_max->is_valid) { continue; }
+
+        max_diff = std::max(
+             max_diff
+            ,std::static_pointer_cast<arrow::DoubleScalar>(col_max)->value
+        );
+    }
+
+    return max_diff;
+}
+
+
+// >> Matrix layout
+
+bool
+IsMatrixLayout(const Schema &table_schema) {
+    if (table_schema.num_fields() != 2) { return false; }
+
+    const auto &block_type = table_schema.field(1)->type();
+    if (block_type->id() != arrow::Type::FIXED_SIZE_LIST) { return false; }
+
+    // samples may be float32 or float64 (see `ToFloat32`)
+    const auto &list_type = static_cast<const arrow::FixedSizeListType &>(*block_type);
+    return (
+           list_type.value_type()->id() == arrow::Type::DOUBLE
+        or list_type.value_type()->id() == arrow::Type::FLOAT
+    );
+}
+
+/**
+ * Convert a wide table (key column, then float64 sample columns from `col_startndx` on)
+ * to the matrix layout. Each chunk of the key column becomes one chunk of the sample
+ * block, so the result keeps the record batch boundaries of the source.
+ */
 Result<shared_ptr<Table>>
-SelectTableByRow(shared_ptr<Table> input_table, Int64Vec &row_indices) {
-    // Add indices of encodedIDs to selection indices
-    auto convert_result = VecToArrow<int64_t, arrow::Int64Builder>(row_indices);
-    if (not convert_result.ok()) {
-        return arrow::Status::Invalid("Could not convert vector to array");
+ToMatrixLayout(shared_ptr<Table> wide_table, int64_t col_startndx) {
+    int64_t sample_count = wide_table->num_columns() - col_startndx;
+    if (col_startndx < 1 or sample_count <= 0) {
+        return Status::Invalid("Expected a key column followed by sample columns");
+    }
+
+    StrVec sample_names;
+    sample_names.reserve(sample_count);
+    for (int64_t col_ndx = col_startndx; col_ndx < wide_table->num_columns(); ++col_ndx) {
+        auto col_field = wide_table->schema()->field(col_ndx);
+        if (col_field->type()->id() != arrow::Type::DOUBLE) {
+            return Status::TypeError(
+                "Matrix layout expects float64 samples; column ", col_ndx
+               ," is ", col_field->type()->ToString()
+            );
+        }
+
+        if (wide_table->column(col_ndx)->null_count() > 0) {
+            return Status::Invalid("Matrix layout does not support null values");
+        }
+
+        sample_names.push_back(col_field->name());
     }
 
+    // samples are written as rows, so line the sample columns up with the key's chunks
+    auto    key_col    = wide_table->column(0);
+    int64_t row_offset = 0;
+
+    ArrayVector block_chunks;
+    for (const auto &key_chunk : key_col->chunks()) {
+        int64_t chunk_rows = key_chunk->length();
+        ARROW_ASSIGN_OR_RAISE(
+             shared_ptr<Buffer> block_buffer
+            ,arrow::AllocateBuffer(chunk_rows * sample_count * static_cast<int64_t>(sizeof(double)))
+        );
+
+        // transpose: sample s of row r goes to r * sample_count + s
+        double *block_vals = reinterpret_cast<double *>(block_buffer->mutable_data());
+        for (int64_t sample_ndx = 0; sample_ndx < sample_count; ++sample_ndx) {
+            auto    sample_vals = wide_table->column(col_startndx + sample_ndx)->Slice(row_offset, chunk_rows);
+            int64_t row_ndx     = 0;
+
+            for (const auto &sample_chunk : sample_vals->chunks()) {
+                auto chunk_vals = std::static_pointer_cast<arrow::DoubleArray>(sample_chunk)->raw_values();
+                for (int64_t chunk_ndx = 0; chunk_ndx < sample_chunk->length(); ++chunk_ndx, ++row_ndx) {
+                    block_vals[row_ndx * sample_count + sample_ndx] = chunk_vals[chunk_ndx];
+                }
+            }
+        }
+
+        row_offset += chunk_rows;
+
+        ARROW_ASSIGN_OR_RAISE(
+             auto block_chunk
+            ,arrow::FixedSizeListArray::FromArrays(
+                  std::make_shared<arrow::DoubleArray>(chunk_rows * sample_count, block_buffer)
+                 ,static_cast<int32_t>(sample_count)
+             )
+        );
+
+        block_chunks.push_back(block_chunk);
+    }
+
+    std::string names_joined;
+    for (const auto &sample_name : sample_names) {
+        if (not names_joined.empty()) { names_joined += '\t'; }
+        names_joined += sample_name;
+    }
+
+    auto block_field = arrow::field(
+         matrix_field_name
+        ,arrow::fixed_size_list(arrow::float64(), static_cast<int32_t>(sample_count))
+        ,/*nullable=*/ false
+        ,arrow::key_value_metadata({ matrix_names_key }, { names_joined })
+    );
+
+    return Table::Make(
+         arrow::schema({ wide_table->schema()->field(0), block_field }, wide_table->schema()->metadata())
+        ,{ key_col, std::make_shared<ChunkedArray>(block_chunks, block_field->type()) }
+    );
+}
+
+
+Result<shared_ptr<Table>>
+ToFloat32(shared_ptr<Table> src_table, int64_t col_startndx) {
+    std::vector<shared_ptr<Field>>        dst_fields;
+    std::vector<shared_ptr<ChunkedArray>> dst_cols;
+
+    for (int64_t col_ndx = 0; col_ndx < src_table->num_columns(); ++col_ndx) {
+        auto col_field = src_table->schema()->field(col_ndx);
+        auto col_vals  = src_table->column(col_ndx);
+
+        shared_ptr<DataType> dst_type;
+        if (col_ndx >= col_startndx and col_field->type()->id() == arrow::Type::DOUBLE) {
+            dst_type = arrow::float32();
+        }
+
+        else if (col_ndx >= col_startndx and IsMatrixLayout(*src_table->schema())) {
+            auto block_type = std::static_pointer_cast<arrow::FixedSizeListType>(col_field->type());
+            dst_type        = arrow::fixed_size_list(
+                block_type->value_field()->WithType(arrow::float32()), block_type->list_size()
+            );
+        }
+
+        if (dst_type == nullptr or dst_type->Equals(col_field->type())) {
+            dst_fields.push_back(col_field);
+            dst_cols.push_back(col_vals);
+            continue;
+        }
+
+        ARROW_ASSIGN_OR_RAISE(Datum dst_vals, arrow::compute::Cast(col_vals, dst_type));
+        dst_fields.push_back(col_field->WithType(dst_type));
+        dst_cols.push_back(dst_vals.chunked_array());
+    }
+
+    return Table::Make(
+         arrow::schema(dst_fields, src_table->schema()->metadata())
+        ,dst_cols
+        ,src_table->num_rows()
+    );
+}
+
+
+// >> Alignment (hash join of a table's key column against an ordered list of keys)
+
+namespace {
+
+/**
+ * Flat, open-addressing hash index from key to row, with linear probing. Each slot keeps
+ * the key's hash next to its row, so most probes compare 8 bytes instead of a string.
+ * Duplicate keys map to their first row.
+ */
+class KeyIndex {
+    public:
+        Status Build(const ChunkedArray &src_keys);
+        int64_t Find(string_view key_val) const;
+
+    private:
+        struct Slot {
+            uint64_t key_hash;
+            int64_t  row_ndx;
+        };
+
+        std::vector<string_view> row_keys;
+        std::vector<Slot>        slots;
+        uint64_t                 slot_mask { 0 };
+};
+
+// Key columns are string (or binary) arrays; this reads either without copying
+static Status
+CheckKeyType(const DataType &key_type) {
+    if (key_type.id() != arrow::Type::STRING and key_type.id() != arrow::Type::BINARY) {
+        return Status::TypeError("Expected string keys; got ", key_type.ToString());
+    }
+
+    return Status::OK();
+}
+
+Status
+KeyIndex::Build(const ChunkedArray &src_keys) {
+    ARROW_RETURN_NOT_OK(CheckKeyType(*src_keys.type()));
+
+    // at most half full, so probe sequences stay short
+    uint64_t slot_count = 16;
+    while (slot_count < 2 * static_cast<uint64_t>(src_keys.length())) { slot_count *= 2; }
+
+    slots.assign(slot_count, Slot { 0, -1 });
+    slot_mask = slot_count - 1;
+
+    row_keys.clear();
+    row_keys.reserve(src_keys.length());
+    for (const auto &key_chunk : src_keys.chunks()) {
+        auto chunk_keys = static_cast<const arrow::BinaryArray *>(key_chunk.get());
+
+        for (int64_t chunk_ndx = 0; chunk_ndx < chunk_keys->length(); ++chunk_ndx) {
+            int64_t row_ndx = static_cast<int64_t>(row_keys.size());
+            row_keys.push_back(chunk_keys->GetView(chunk_ndx));
+
+            // null keys never match
+            if (chunk_keys->IsNull(chunk_ndx)) { continue; }
+
+            uint64_t key_hash = std::hash<string_view> {}(row_keys.back());
+            uint64_t slot_ndx = key_hash & slot_mask;
+            while (slots[slot_ndx].row_ndx >= 0) {
+                if (    slots[slot_ndx].key_hash == key_hash
+                    and row_keys[slots[slot_ndx].row_ndx] == row_keys.back()) {
+                    break;
+                }
+
+                slot_ndx = (slot_ndx + 1) & slot_mask;
+            }
+
+            if (slots[slot_ndx].row_ndx < 0) { slots[slot_ndx] = Slot { key_hash, row_ndx }; }
+        }
+    }
+
+    return Status::OK();
+}
+
+int64_t
+KeyIndex::Find(string_view key_val) const {
+    uint64_t key_hash = std::hash<string_view> {}(key_val);
+    uint64_t slot_ndx = key_hash & slot_mask;
+
+    while (slots[slot_ndx].row_ndx >= 0) {
+        if (    slots[slot_ndx].key_hash == key_hash
+            and row_keys[slots[slot_ndx].row_ndx] == key_val) {
+            return slots[slot_ndx].row_ndx;
+        }
+
+        slot_ndx = (slot_ndx + 1) & slot_mask;
+    }
+
+    return -1;
+}
+
+// Where each gathered row is in a chunked column (chunk -1 for a missing row). Columns
+// from the same file share a chunk layout, so locations are computed once per layout.
+struct ChunkLocations {
+    std::vector<int64_t> chunk_lengths;
+    std::vector<int32_t> chunk_ndxs;
+    std::vector<int64_t> chunk_offsets;
+
+    bool SameLayout(const ChunkedArray &col_vals) const {
+        if (static_cast<size_t>(col_vals.num_chunks()) != chunk_lengths.size()) { return false; }
+
+        for (int chunk_ndx = 0; chunk_ndx < col_vals.num_chunks(); ++chunk_ndx) {
+            if (col_vals.chunk(chunk_ndx)->length() != chunk_lengths[chunk_ndx]) { return false; }
+        }
+
+        return true;
+    }
+
+    void Resolve(const ChunkedArray &col_vals, const Int64Array &gather_ndxs) {
+        chunk_lengths.clear();
+        std::vector<int64_t> chunk_starts;
+        int64_t              chunk_start = 0;
+        for (const auto &col_chunk : col_vals.chunks()) {
+            chunk_starts.push_back(chunk_start);
+            chunk_lengths.push_back(col_chunk->length());
+            chunk_start += col_chunk->length();
+        }
+
+        chunk_ndxs.resize(gather_ndxs.length());
+        chunk_offsets.resize(gather_ndxs.length());
+        for (int64_t row_ndx = 0; row_ndx < gather_ndxs.length(); ++row_ndx) {
+            if (gather_ndxs.IsNull(row_ndx)) { chunk_ndxs[row_ndx] = -1; continue; }
+
+            int64_t src_ndx   = gather_ndxs.Value(row_ndx);
+            auto    chunk_pos = std::upper_bound(chunk_starts.begin(), chunk_starts.end(), src_ndx);
+            int32_t chunk_ndx = static_cast<int32_t>(chunk_pos - chunk_starts.begin()) - 1;
+
+            chunk_ndxs[row_ndx]    = chunk_ndx;
+            chunk_offsets[row_ndx] = src_ndx - chunk_starts[chunk_ndx];
+        }
+    }
+};
+
+// Gather 1 fixed-width column in a single pass; missing rows get `fill_val`
+template<typename ArrowType>
+static Result<shared_ptr<Array>>
+GatherValues( const ChunkedArray                &col_vals
+             ,const ChunkLocations              &row_locs
+             ,typename ArrowType::c_type         fill_val) {
+    using CType     = typename ArrowType::c_type;
+    using ArrayType = typename arrow::TypeTraits<ArrowType>::ArrayType;
+
+    std::vector<const CType *> chunk_vals;
+    for (const auto &col_chunk : col_vals.chunks()) {
+        chunk_vals.push_back(static_cast<const ArrayType *>(col_chunk.get())->raw_values());
+    }
+
+    int64_t row_count = static_cast<int64_t>(row_locs.chunk_ndxs.size());
     ARROW_ASSIGN_OR_RAISE(
-         Datum selection
-        ,Take(input_table, convert_result.ValueOrDie())
+         shared_ptr<Buffer> dst_buffer
+        ,arrow::AllocateBuffer(row_count * static_cast<int64_t>(sizeof(CType)))
     );
 
-    return std::move(selection).table();
+    CType *dst_vals = reinterpret_cast<CType *>(dst_buffer->mutable_data());
+    for (int64_t row_ndx = 0; row_ndx < row_count; ++row_ndx) {
+        int32_t chunk_ndx = row_locs.chunk_ndxs[row_ndx];
+        dst_vals[row_ndx] = (
+              chunk_ndx < 0
+            ? fill_val
+            : chunk_vals[chunk_ndx][row_locs.chunk_offsets[row_ndx]]
+        );
+    }
+
+    return shared_ptr<Array> { std::make_shared<ArrayType>(row_count, dst_buffer) };
 }
 
+// Gene codes index a dictionary, so a flat table from code to row replaces the hash index
+static Result<shared_ptr<Int64Array>>
+AlignRowsByCode(const ChunkedArray &ordered_codes, const ChunkedArray &src_codes) {
+    int32_t max_code = -1;
+    for (const auto *code_col : { &ordered_codes, &src_codes }) {
+        for (const auto &code_chunk : code_col->chunks()) {
+            auto chunk_codes = static_cast<const Int32Array *>(code_chunk.get());
+
+            for (int64_t chunk_ndx = 0; chunk_ndx < chunk_codes->length(); ++chunk_ndx) {
+                if (chunk_codes->IsNull(chunk_ndx)) { continue; }
+
+                if (chunk_codes->Value(chunk_ndx) < 0) {
+                    return Status::Invalid("Negative gene code: ", chunk_codes->Value(chunk_ndx));
+                }
+
+                max_code = std::max(max_code, chunk_codes->Value(chunk_ndx));
+            }
+        }
+    }
 
-// >> Utility functions for complex operations
+    // null codes never match; duplicate codes map to their first row
+    std::vector<int64_t> row_for_code(static_cast<size_t>(max_code) + 1, -1);
+    int64_t              row_ndx = 0;
+    for (const auto &code_chunk : src_codes.chunks()) {
+        auto chunk_codes = static_cast<const Int32Array *>(code_chunk.get());
 
-// NOTE: this uses string_view, because CopyMatchedRows does. Maybe figure out how to generalize
-// this later
-shared_ptr<RecordBatch>
-CreateEmptyRecordBatch(shared_ptr<Schema> batch_schema, StrVec &row_ids) {
-    // can be parameterized later; if desired
-    double         default_fillval = 0;
-    ArrayVector    batch_data;
-    vector<double> fill_values(row_ids.size(), default_fillval);
+        for (int64_t chunk_ndx = 0; chunk_ndx < chunk_codes->length(); ++chunk_ndx, ++row_ndx) {
+            if (chunk_codes->IsNull(chunk_ndx)) { continue; }
 
-    // First, add the IDs (assumed to be gene IDs for now)
-    auto rowid_result = VecToArrow<string, arrow::StringBuilder>(row_ids);
-    if (not rowid_result.ok()) {
-        std::cerr << "Unable to set IDs for empty RecordBatch" << std::endl;
-        return nullptr;
+            auto &code_row = row_for_code[chunk_codes->Value(chunk_ndx)];
+            if (code_row < 0) { code_row = row_ndx; }
+        }
     }
 
-    batch_data.emplace_back(rowid_result.ValueOrDie());
+    arrow::Int64Builder gather_builder;
+    ARROW_RETURN_NOT_OK(gather_builder.Reserve(ordered_codes.length()));
+
+    for (const auto &code_chunk : ordered_codes.chunks()) {
+        auto chunk_codes = static_cast<const Int32Array *>(code_chunk.get());
 
-    // Then, fill all of the <empty> values
-    for (int col_ndx = 1; col_ndx < batch_schema->num_fields(); ++col_ndx) {
-        auto fill_result = VecToArrow<double, arrow::DoubleBuilder>(fill_values);
-        if (not fill_result.ok()) {
-            std::cerr << "Unable to fill column for empty RecordBatch"
-                      << " [" << col_ndx << "]"
-                      << std::endl
-            ;
+        for (int64_t chunk_ndx = 0; chunk_ndx < chunk_codes->length(); ++chunk_ndx) {
+            int64_t src_ndx = (
+                  chunk_codes->IsNull(chunk_ndx)
+                ? -1
+                : row_for_code[chunk_codes->Value(chunk_ndx)]
+            );
 
-            return nullptr;
+            if (src_ndx < 0) { gather_builder.UnsafeAppendNull(); }
+            else             { gather_builder.UnsafeAppend(src_ndx); }
         }
+    }
+
+    shared_ptr<Int64Array> gather_ndxs;
+    ARROW_RETURN_NOT_OK(gather_builder.Finish(&gather_ndxs));
+
+    return gather_ndxs;
+}
+
+static std::string
+FingerprintHex(uint64_t key_fp) {
+    char fp_hex[17];
+    std::snprintf(fp_hex, sizeof(fp_hex), "%016llx", static_cast<unsigned long long>(key_fp));
+
+    return std::string { fp_hex };
+}
+
+} // namespace
+
+
+/**
+ * Hash join of `ordered_ids` against the key column (column 0) of `src_keys`: the result
+ * has 1 entry per ordered ID, which is the row of `src_keys` with that ID, or null. When
+ * both are gene codes, the join is a lookup in a table indexed by code.
+ */
+Result<shared_ptr<Int64Array>>
+AlignRowsByKey(shared_ptr<ChunkedArray> ordered_ids, shared_ptr<ChunkedArray> src_keys) {
+    bool ordered_coded = (ordered_ids->type()->id() == arrow::Type::INT32);
+    bool src_coded     = (src_keys->type()->id()    == arrow::Type::INT32);
+
+    if (ordered_coded and src_coded) { return AlignRowsByCode(*ordered_ids, *src_keys); }
+    if (ordered_coded or  src_coded) {
+        return Status::TypeError("Can't align gene codes with gene IDs; encode both sides");
+    }
 
-        batch_data.emplace_back(fill_result.ValueOrDie());
+    ARROW_RETURN_NOT_OK(CheckKeyType(*ordered_ids->type()));
+
+    KeyIndex src_index;
+    ARROW_RETURN_NOT_OK(src_index.Build(*src_keys));
+
+    arrow::Int64Builder gather_builder;
+    ARROW_RETURN_NOT_OK(gather_builder.Reserve(ordered_ids->length()));
+
+    for (const auto &id_chunk : ordered_ids->chunks()) {
+        auto chunk_ids = static_cast<const arrow::BinaryArray *>(id_chunk.get());
+
+        for (int64_t chunk_ndx = 0; chunk_ndx < chunk_ids->length(); ++chunk_ndx) {
+            int64_t src_ndx = (
+                  chunk_ids->IsNull(chunk_ndx)
+                ? -1
+                : src_index.Find(chunk_ids->GetView(chunk_ndx))
+            );
+
+            if (src_ndx < 0) { gather_builder.UnsafeAppendNull(); }
+            else             { gather_builder.UnsafeAppend(src_ndx); }
+        }
     }
 
-    return RecordBatch::Make(batch_schema, row_ids.size(), batch_data);
+    shared_ptr<Int64Array> gather_ndxs;
+    ARROW_RETURN_NOT_OK(gather_builder.Finish(&gather_ndxs));
+
+    return gather_ndxs;
 }
 
+// Float and integer columns, which alignment zero-fills where a row is missing
+static bool
+IsZeroFilledType(arrow::Type::type type_id) {
+    return (
+           type_id == arrow::Type::DOUBLE or type_id == arrow::Type::FLOAT
+        or type_id == arrow::Type::INT64  or type_id == arrow::Type::INT32
+    );
+}
+
+/**
+ * Gather 1 column with arrow's `Take`. Missing rows (`missing_rows` is true) of float and
+ * integer columns are then set to 0, as `GatherValues` does; nulls of the source rows that
+ * did match are kept.
+ */
+static Result<shared_ptr<ChunkedArray>>
+TakeAlignedColumn( shared_ptr<ChunkedArray>  col_vals
+                  ,shared_ptr<Int64Array>    gather_ndxs
+                  ,const Datum              &missing_rows) {
+    ARROW_ASSIGN_OR_RAISE(Datum dst_vals, Take(col_vals, gather_ndxs));
+    if (not IsZeroFilledType(col_vals->type()->id())) { return dst_vals.chunked_array(); }
+
+    ARROW_ASSIGN_OR_RAISE(auto zero_val   , arrow::MakeScalar(col_vals->type(), 0));
+    ARROW_ASSIGN_OR_RAISE(auto filled_vals, arrow::compute::IfElse(missing_rows, zero_val, dst_vals));
+
+    return filled_vals.chunked_array();
+}
+
+/**
+ * Gather the rows of `src_table` given by `gather_ndxs` (see `AlignRowsByKey`), with one
+ * pass per column. The key column of the result is `ordered_ids`, as is. Missing (null)
+ * rows of float and integer columns are filled with 0; if every row is missing, those
+ * columns share a single zero-filled buffer. Other column types, or columns with nulls,
+ * use arrow's `Take` (see `TakeAlignedRows`); missing rows of other types are null. When
+ * the gather is the identity, `src_table` is returned as is.
+ */
 Result<shared_ptr<Table>>
-CopyMatchedRows(shared_ptr<ChunkedArray> ordered_ids, shared_ptr<Table> src_table) {
-    // hash primary keys (gene IDs) in src_table to match against later
-    int64_t src_rowndx = 0;
-    auto    src_keys   = src_table->column(0);
+GatherAlignedRows( shared_ptr<Table>        src_table
+                  ,shared_ptr<Int64Array>   gather_ndxs
+                  ,shared_ptr<ChunkedArray> ordered_ids) {
+    int64_t row_count = gather_ndxs->length();
+    if (ordered_ids->length() != row_count) {
+        return Status::Invalid("Expected ", row_count, " ordered IDs; got ", ordered_ids->length());
+    }
+
+    // >> identity: every row matched, in source order
+    bool is_identity = (row_count == src_table->num_rows() and gather_ndxs->null_count() == 0);
+    for (int64_t row_ndx = 0; is_identity and row_ndx < row_count; ++row_ndx) {
+        is_identity = (gather_ndxs->Value(row_ndx) == row_ndx);
+    }
 
-    unordered_map<string_view, int64_t> src_keymap;
-    src_keymap.reserve((size_t) src_keys->length());
+    if (is_identity) { return src_table; }
 
-    // >> TODO: get start time here
-    for (int chunk_ndx = 0; chunk_ndx < src_keys->num_chunks(); ++chunk_ndx) {
-        shared_ptr<StringArray> chunk_srckeys = std::static_pointer_cast<StringArray>(
-            src_keys->chunk(chunk_ndx)
+    // >> no matches: every gathered value is the fill value
+    bool               all_missing = (gather_ndxs->null_count() == row_count);
+    shared_ptr<Buffer> zero_buffer;
+    if (all_missing) {
+        ARROW_ASSIGN_OR_RAISE(
+             zero_buffer
+            ,arrow::AllocateBuffer(row_count * static_cast<int64_t>(sizeof(int64_t)))
         );
 
-        for (const auto src_key : *chunk_srckeys) {
-            if (not src_key.has_value()) { continue; }
+        std::fill(zero_buffer->mutable_data(), zero_buffer->mutable_data() + zero_buffer->size(), 0);
+    }
+
+    // computed for the first column that goes through `Take`
+    Datum missing_rows;
+
+    ChunkLocations                        row_locs;
+    std::vector<shared_ptr<ChunkedArray>> dst_cols { ordered_ids };
+    for (int col_ndx = 1; col_ndx < src_table->num_columns(); ++col_ndx) {
+        const auto &col_vals = src_table->column(col_ndx);
+        auto        type_id  = col_vals->type()->id();
+
+        if (not IsZeroFilledType(type_id) or col_vals->null_count() > 0) {
+            if (missing_rows.kind() == Datum::NONE) {
+                ARROW_ASSIGN_OR_RAISE(missing_rows, arrow::compute::IsNull(gather_ndxs));
+            }
+
+            ARROW_ASSIGN_OR_RAISE(auto dst_vals, TakeAlignedColumn(col_vals, gather_ndxs, missing_rows));
+            dst_cols.push_back(dst_vals);
+            continue;
+        }
+
+        if (all_missing) {
+            dst_cols.push_back(std::make_shared<ChunkedArray>(
+                arrow::MakeArray(arrow::ArrayData::Make(
+                    col_vals->type(), row_count, { nullptr, zero_buffer }, 0
+                ))
+            ));
 
-            // add a mapping of this value (gene ID) to it's row index
-            src_keymap.insert({ src_key.value(), src_rowndx });
-            ++src_rowndx;
+            continue;
         }
+
+        if (not row_locs.SameLayout(*col_vals)) { row_locs.Resolve(*col_vals, *gather_ndxs); }
+
+        Result<shared_ptr<Array>> gather_result;
+        switch (type_id) {
+            case arrow::Type::DOUBLE: gather_result = GatherValues<arrow::DoubleType>(*col_vals, row_locs, 0); break;
+            case arrow::Type::FLOAT:  gather_result = GatherValues<arrow::FloatType >(*col_vals, row_locs, 0); break;
+            case arrow::Type::INT64:  gather_result = GatherValues<arrow::Int64Type >(*col_vals, row_locs, 0); break;
+            default:                  gather_result = GatherValues<arrow::Int32Type >(*col_vals, row_locs, 0); break;
+        }
+
+        ARROW_ASSIGN_OR_RAISE(auto dst_vals, gather_result);
+        dst_cols.push_back(std::make_shared<ChunkedArray>(dst_vals));
     }
 
-    // Construct a vector of RecordBatches to convert into a result table
-    StrVec            missing_ids;
-    Int64Vec          match_indices;
-    RecordBatchVector result_batches;
+    // the key field's type comes from `ordered_ids`
+    auto dst_schema = src_table->schema();
+    if (not dst_schema->field(0)->type()->Equals(ordered_ids->type())) {
+        ARROW_ASSIGN_OR_RAISE(
+             dst_schema
+            ,dst_schema->SetField(0, dst_schema->field(0)->WithType(ordered_ids->type()))
+        );
+    }
 
-    // >> TODO: interval time: source keymap <--> populate missing rows
-    for (int chunk_ndx = 0; chunk_ndx < ordered_ids->num_chunks(); ++chunk_ndx) {
-        shared_ptr<StringArray> chunk_srckeys = std::static_pointer_cast<StringArray>(
-            ordered_ids->chunk(chunk_ndx)
+    return Table::Make(dst_schema, dst_cols, row_count);
+}
+
+/**
+ * Reference for `GatherAlignedRows`: every column goes through `Take` (then the zero fill
+ * of `TakeAlignedColumn`), so the 2 must return equal tables.
+ */
+Result<shared_ptr<Table>>
+TakeAlignedRows( shared_ptr<Table>        src_table
+                ,shared_ptr<Int64Array>   gather_ndxs
+                ,shared_ptr<ChunkedArray> ordered_ids) {
+    ARROW_ASSIGN_OR_RAISE(Datum missing_rows, arrow::compute::IsNull(gather_ndxs));
+
+    std::vector<shared_ptr<ChunkedArray>> dst_cols { ordered_ids };
+    for (int col_ndx = 1; col_ndx < src_table->num_columns(); ++col_ndx) {
+        ARROW_ASSIGN_OR_RAISE(
+             auto dst_vals
+            ,TakeAlignedColumn(src_table->column(col_ndx), gather_ndxs, missing_rows)
         );
 
-        /* NOTE: put_time comes from <iomanip>
-        // time stamp each iteration: find variability in processing each chunk
-        auto timestamp = std::time(nullptr);
-        std::cout << "[" << std::put_time(std::localtime(&timestamp), "%T") << "] "
-                  << "chunk: " << chunk_ndx
-                  << std::endl
-        ;
-        */
+        dst_cols.push_back(dst_vals);
+    }
 
-        for (const auto src_key : *chunk_srckeys) {
-            auto src_keyval = src_key.value_or("");
+    auto dst_schema = src_table->schema();
+    ARROW_ASSIGN_OR_RAISE(
+         dst_schema
+        ,dst_schema->SetField(0, dst_schema->field(0)->WithType(ordered_ids->type()))
+    );
 
-            // If the source value is found, add the matched index
-            if (src_key.has_value() and src_keymap.count(src_keyval)) {
-                // Since we have a match, drain all mismatches
-                if (missing_ids.size() > 0) {
-                    result_batches.push_back(
-                        CreateEmptyRecordBatch(src_table->schema(), missing_ids)
-                    );
+    return Table::Make(dst_schema, dst_cols, gather_ndxs->length());
+}
 
-                    missing_ids.clear();
-                }
+/**
+ * Align `src_table` to `ordered_ids`: row i of the result is the row of `src_table` whose
+ * key (column 0) is ordered_ids[i], or a row of zeros when there is no such row.
+ */
+Result<shared_ptr<Table>>
+CopyMatchedRows(shared_ptr<ChunkedArray> ordered_ids, shared_ptr<Table> src_table) {
+    ARROW_ASSIGN_OR_RAISE(auto gather_ndxs, AlignRowsByKey(ordered_ids, src_table->column(0)));
 
-                match_indices.push_back(src_keymap[src_keyval]);
+    return GatherAlignedRows(src_table, gather_ndxs, ordered_ids);
+}
 
-                // use `continue` to reduce code indentation for the "else" case
-                continue;
-            }
 
-            // Otherwise, drain matches by appending `take` selection as RecordBatches
-            if (match_indices.size() > 0) {
-                ARROW_ASSIGN_OR_RAISE(
-                     auto table_selection
-                    ,SelectTableByRow(src_table, match_indices)
-                )
-
-                // push RecordBatches onto the end of result_batches
-                TableBatchReader batch_converter(*table_selection);
-
-                // `ReadAll` batches from table_selection
-                shared_ptr<RecordBatch> result_batch { nullptr };
-                auto status_readbatch = batch_converter.ReadNext(&result_batch);
-                while (status_readbatch.ok() and result_batch != nullptr) {
-                  result_batches.push_back(result_batch);
-                  result_batch.reset();
-                }
+// >> Alignment cache
 
-                // Print the not ok status to be sure that
-                if (not status_readbatch.ok()) {
-                  std::cerr << "Error reading table batches: "
-                            << status_readbatch.message()
-                            << std::endl
-                  ;
+/**
+ * Each value is hashed with arrow's (stable) string hash and mixed into the running hash
+ * with its position implied by order, so equal columns have equal fingerprints however
+ * they are chunked. Nulls mix in a constant that no value hash is likely to collide with.
+ */
+Result<uint64_t>
+KeyFingerprint(const ChunkedArray &key_col) {
+    ARROW_RETURN_NOT_OK(CheckKeyType(*key_col.type()));
 
-                  return status_readbatch;
-                }
+    constexpr uint64_t mix_mult  = 0x9E3779B97F4A7C15ULL;
+    constexpr uint64_t null_hash = 0xA5A5A5A5A5A5A5A5ULL;
 
-                match_indices.clear();
+    uint64_t key_fp = static_cast<uint64_t>(key_col.length()) * mix_mult;
+    for (const auto &key_chunk : key_col.chunks()) {
+        auto chunk_keys = static_cast<const arrow::BinaryArray *>(key_chunk.get());
+
+        for (int64_t chunk_ndx = 0; chunk_ndx < chunk_keys->length(); ++chunk_ndx) {
+            uint64_t val_hash = null_hash;
+            if (not chunk_keys->IsNull(chunk_ndx)) {
+                auto key_val = chunk_keys->GetView(chunk_ndx);
+                val_hash     = arrow::internal::ComputeStringHash<0>(
+                    key_val.data(), static_cast<int64_t>(key_val.size())
+                );
             }
 
-            // if we're here, then the ID didn't have a hit in src_keymap
-            missing_ids.push_back(string { src_keyval });
+            key_fp  = (key_fp ^ val_hash) * mix_mult;
+            key_fp ^= key_fp >> 29;
         }
     }
 
-    // std::cout << std::endl;
+    return key_fp;
+}
+
+AlignmentCache::AlignmentCache(std::string cache_dirpath)
+    : cache_dirpath(std::move(cache_dirpath)) {}
 
-    // drain any remaining missing IDs
-    if (missing_ids.size() > 0) {
-        result_batches.push_back(
-            CreateEmptyRecordBatch(src_table->schema(), missing_ids)
-        );
+// Map an entry; it is only used if it was made for inputs of the same shape
+Result<shared_ptr<Int64Array>>
+AlignmentCache::LoadEntry(const std::string &entry_fpath, int64_t order_len, int64_t src_len) {
+    ARROW_ASSIGN_OR_RAISE(
+         auto entry_table
+        ,ReadIPCFile(UriForPath(entry_fpath), IOStrategy::Mmap)
+    );
 
-        missing_ids.clear();
+    if (   entry_table->num_columns() != 1
+        or entry_table->num_rows()    != order_len
+        or entry_table->column(0)->type()->id() != arrow::Type::INT64) {
+        return Status::Invalid("Malformed alignment cache entry [", entry_fpath, "]");
     }
 
-    // drain any remaining matched IDs
-    if (match_indices.size() > 0) {
-        ARROW_ASSIGN_OR_RAISE(
-             auto table_selection
-            ,SelectTableByRow(src_table, match_indices)
-        )
-
-        // push RecordBatches onto the end of result_batches
-        TableBatchReader batch_converter(*table_selection);
-
-        // `ReadAll` batches from table_selection
-        shared_ptr<RecordBatch> result_batch { nullptr };
-        auto status_readbatch = batch_converter.ReadNext(&result_batch);
-        while (status_readbatch.ok() and result_batch != nullptr) {
-          result_batches.push_back(result_batch);
-          result_batch.reset();
+    shared_ptr<Array> entry_ndxs;
+    if (entry_table->column(0)->num_chunks() == 1) {
+        entry_ndxs = entry_table->column(0)->chunk(0);
+    }
+    else {
+        ARROW_ASSIGN_OR_RAISE(entry_ndxs, arrow::Concatenate(entry_table->column(0)->chunks()));
+    }
+
+    // every gathered row must exist in the source; an entry that doesn't (e.g. corrupt or
+    // made for other inputs) is a miss
+    auto gather_ndxs = std::static_pointer_cast<Int64Array>(entry_ndxs);
+    for (int64_t row_ndx = 0; row_ndx < order_len; ++row_ndx) {
+        if (not gather_ndxs->IsValid(row_ndx)) { continue; }
+
+        int64_t src_ndx = gather_ndxs->Value(row_ndx);
+        if (src_ndx < 0 or src_ndx >= src_len) {
+            return Status::Invalid("Alignment cache entry [", entry_fpath, "] is out of range");
         }
+    }
 
-        if (not status_readbatch.ok()) {
-          std::cerr << "Error reading batches: "
-                    << status_readbatch.message()
-                    << std::endl
-          ;
+    return gather_ndxs;
+}
+
+// Write to a temporary file, then rename it, so readers never see a partial entry. The
+// temporary file is unique per save, so concurrent saves of 1 entry don't collide.
+Status
+AlignmentCache::SaveEntry(const std::string &entry_fpath, shared_ptr<Int64Array> gather_ndxs) {
+    static std::atomic<int64_t> save_count { 0 };
+
+    std::error_code fs_err;
+    std::filesystem::create_directories(cache_dirpath, fs_err);
+    if (fs_err) {
+        return Status::IOError("Couldn't create [", cache_dirpath, "]: ", fs_err.message());
+    }
 
-          return status_readbatch;
+    auto entry_table = Table::Make(
+         arrow::schema({ arrow::field("gather_ndx", arrow::int64()) })
+        ,{ std::make_shared<ChunkedArray>(gather_ndxs) }
+    );
+
+    auto write_props = UncompressedWriteProps(gather_ndxs->length());
+
+    std::string temp_fpath {
+        entry_fpath + ".tmp." + std::to_string(getpid()) + "." + std::to_string(save_count++)
+    };
+
+    ARROW_RETURN_NOT_OK(WriteIPCFile(UriForPath(temp_fpath), entry_table, write_props));
+
+    std::filesystem::rename(temp_fpath, entry_fpath, fs_err);
+    if (fs_err) {
+        std::filesystem::remove(temp_fpath);
+        return Status::IOError("Couldn't save [", entry_fpath, "]: ", fs_err.message());
+    }
+
+    return Status::OK();
+}
+
+/**
+ * Look up the gather indices for `src_keys` against `ordered_ids`; on a miss, they are
+ * computed with `AlignRowsByKey` and saved. A malformed entry is treated as a miss, and a
+ * failure to save only means the next run misses too.
+ */
+Result<shared_ptr<Int64Array>>
+AlignmentCache::GatherIndices( shared_ptr<ChunkedArray> ordered_ids
+                              ,shared_ptr<ChunkedArray> src_keys) {
+    // gene codes align faster than they could be fingerprinted
+    bool is_coded = (src_keys->type()->id() == arrow::Type::INT32);
+    if (is_coded or ordered_ids->length() == 0) { return AlignRowsByKey(ordered_ids, src_keys); }
+
+    uint64_t order_fp;
+    {
+        std::lock_guard<std::mutex> order_guard { order_lock };
+        if (ordered_ids != last_order) {
+            ARROW_ASSIGN_OR_RAISE(last_order_fp, KeyFingerprint(*ordered_ids));
+            last_order = ordered_ids;
+        }
+
+        order_fp = last_order_fp;
+    }
+
+    ARROW_ASSIGN_OR_RAISE(auto src_fp, KeyFingerprint(*src_keys));
+
+    auto entry_fname = FingerprintHex(src_fp) + "-" + FingerprintHex(order_fp) + ".arrow";
+    auto entry_fpath = (std::filesystem::absolute(cache_dirpath) / entry_fname).string();
+    if (std::filesystem::exists(entry_fpath)) {
+        auto load_result = LoadEntry(entry_fpath, ordered_ids->length(), src_keys->length());
+        if (load_result.ok()) {
+            ++hits;
+            return load_result;
+        }
+    }
+
+    ++misses;
+    ARROW_ASSIGN_OR_RAISE(auto gather_ndxs, AlignRowsByKey(ordered_ids, src_keys));
+
+    auto save_status = SaveEntry(entry_fpath, gather_ndxs);
+    if (not save_status.ok()) {
+        std::cerr << "Alignment not cached:" << std::endl
+                  << "\t" << save_status.ToString() << std::endl
+        ;
+    }
+
+    return gather_ndxs;
+}
+
+Result<shared_ptr<Table>>
+CopyMatchedRows( shared_ptr<ChunkedArray>  ordered_ids
+                ,shared_ptr<Table>         src_table
+                ,AlignmentCache           &align_cache) {
+    ARROW_ASSIGN_OR_RAISE(
+         auto gather_ndxs
+        ,align_cache.GatherIndices(ordered_ids, src_table->column(0))
+    );
+
+    return GatherAlignedRows(src_table, gather_ndxs, ordered_ids);
+}
+
+
+// >> Gene dictionary
+
+Result<GeneDictionary>
+GeneDictionary::FromTable(shared_ptr<Table> annotation_table) {
+    GeneDictionary gene_dict;
+    gene_dict.gene_ids = annotation_table->column(0);
+
+    if (gene_dict.size() > std::numeric_limits<int32_t>::max()) {
+        return Status::Invalid("Too many genes for int32 codes: ", gene_dict.size());
+    }
+
+    ARROW_ASSIGN_OR_RAISE(gene_dict.gene_fp, KeyFingerprint(*gene_dict.gene_ids));
+
+    // codes are row numbers, so aligning the IDs to themselves must be the identity
+    ARROW_ASSIGN_OR_RAISE(auto self_ndxs, AlignRowsByKey(gene_dict.gene_ids, gene_dict.gene_ids));
+    for (int64_t row_ndx = 0; row_ndx < self_ndxs->length(); ++row_ndx) {
+        if (self_ndxs->IsNull(row_ndx) or self_ndxs->Value(row_ndx) != row_ndx) {
+            return Status::Invalid("Gene ID at row ", row_ndx, " is null or a duplicate");
         }
+    }
+
+    arrow::Int32Builder code_builder;
+    ARROW_RETURN_NOT_OK(code_builder.Reserve(gene_dict.size()));
+    for (int32_t gene_code = 0; gene_code < gene_dict.size(); ++gene_code) {
+        code_builder.UnsafeAppend(gene_code);
+    }
+
+    ARROW_ASSIGN_OR_RAISE(auto gene_codes, code_builder.Finish());
+    gene_dict.gene_codes = std::make_shared<ChunkedArray>(gene_codes);
+
+    return gene_dict;
+}
+
+Result<shared_ptr<Table>>
+GeneDictionary::EncodeTable(shared_ptr<Table> src_table, int64_t *dropped_count) const {
+    // the dictionary row of each source gene is its code
+    ARROW_ASSIGN_OR_RAISE(auto code_ndxs, AlignRowsByKey(src_table->column(0), gene_ids));
+    ARROW_ASSIGN_OR_RAISE(
+         Datum src_codes
+        ,arrow::compute::Cast(Datum { code_ndxs }, arrow::int32())
+    );
+
+    auto key_field = src_table->schema()->field(0);
+    auto code_meta = (
+          key_field->HasMetadata()
+        ? key_field->metadata()->Copy()
+        : std::make_shared<KVMetadata>()
+    );
+
+    ARROW_RETURN_NOT_OK(code_meta->Set(gene_dictionary_key, FingerprintHex(gene_fp)));
+    ARROW_ASSIGN_OR_RAISE(
+         auto code_table
+        ,src_table->SetColumn(
+              0
+             ,key_field->WithType(arrow::int32())->WithMetadata(code_meta)
+             ,std::make_shared<ChunkedArray>(src_codes.make_array())
+         )
+    );
+
+    if (dropped_count != nullptr) { *dropped_count = code_ndxs->null_count(); }
+    if (code_ndxs->null_count() == 0) { return code_table; }
+
+    ARROW_ASSIGN_OR_RAISE(Datum is_known , arrow::compute::IsValid(src_codes));
+    ARROW_ASSIGN_OR_RAISE(Datum known_rows, arrow::compute::Filter(code_table, is_known));
+
+    return known_rows.table();
+}
+
+Result<shared_ptr<Table>>
+GeneDictionary::DecodeTable(shared_ptr<Table> encoded_table) const {
+    ARROW_RETURN_NOT_OK(CheckEncoded(*encoded_table->schema()));
+    ARROW_ASSIGN_OR_RAISE(Datum src_ids, Take(gene_ids, encoded_table->column(0)));
 
-        match_indices.clear();
+    auto key_field = encoded_table->schema()->field(0);
+    auto id_meta   = key_field->metadata()->Copy();
+    ARROW_RETURN_NOT_OK(id_meta->Delete(gene_dictionary_key));
+
+    auto id_field = key_field->WithType(gene_ids->type());
+    id_field      = id_meta->size() > 0 ? id_field->WithMetadata(id_meta) : id_field->RemoveMetadata();
+
+    return encoded_table->SetColumn(0, id_field, src_ids.chunked_array());
+}
+
+Status
+GeneDictionary::CheckEncoded(const Schema &table_schema) const {
+    const auto &key_field = table_schema.field(0);
+    if (key_field->type()->id() != arrow::Type::INT32 or not key_field->HasMetadata()) {
+        return Status::TypeError("Key column [", key_field->name(), "] is not gene codes");
     }
 
-    // >> TODO: get finish time for copying source rows into dense table
+    auto dict_fp = key_field->metadata()->Get(gene_dictionary_key);
+    if (not dict_fp.ok() or *dict_fp != FingerprintHex(gene_fp)) {
+        return Status::Invalid(
+            "Key column [", key_field->name(), "] was encoded with a different gene dictionary"
+        );
+    }
 
-    return Table::FromRecordBatches(src_table->schema(), result_batches);
+    return Status::OK();
 }
 
+Result<shared_ptr<ChunkedArray>>
+GeneDictionary::OrderFor(const Table &src_table) const {
+    if (src_table.schema()->field(0)->type()->id() != arrow::Type::INT32) { return gene_ids; }
+
+    ARROW_RETURN_NOT_OK(CheckEncoded(*src_table.schema()));
+    return gene_codes;
+}
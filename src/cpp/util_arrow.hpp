@@ -20,6 +20,8 @@
 // Dependencies
 #pragma once
 
+#include <atomic>
+
 #include "adapter_arrow.hpp"
 
 
@@ -36,19 +38,166 @@ using arrow::compute::Divide;
 using arrow::compute::Multiply;
 using arrow::compute::Power;
 using arrow::compute::AbsoluteValue;
+using arrow::compute::ArithmeticOptions;
+
+// >> Arrow: compute function context (executor and memory pool)
+using arrow::compute::ExecContext;
+using arrow::internal::Executor;
+
+// >> Arrow: Aggregate compute functions
+using arrow::compute::MinMax;
 
 // >> Arrow: Other compute functions
 using arrow::compute::Take;
 
 
+// ------------------------------
+// Matrix layout
+//
+// A wide table stores each sample as its own float64 column. The matrix layout instead
+// stores the key column and one `fixed_size_list<double>[N]` column, named "samples",
+// that holds the whole sample block: row i's N values are contiguous. In both layouts,
+// samples may instead be float32 (see `ToFloat32`). The schema has 2
+// fields no matter how many samples there are; sample names are kept (tab-separated) in
+// the "sample_names" metadata of the "samples" field.
+
+constexpr const char *matrix_field_name = "samples";
+constexpr const char *matrix_names_key  = "sample_names";
+
+bool IsMatrixLayout(const Schema &table_schema);
+
+Result<shared_ptr<Table>>
+ToMatrixLayout(shared_ptr<Table> wide_table, int64_t col_startndx = 1);
+
+// Narrow float64 samples (columns, or the matrix sample block) to float32; aggregation
+// still accumulates in float64, but half as many bytes are stored, read and scanned
+Result<shared_ptr<Table>>
+ToFloat32(shared_ptr<Table> src_table, int64_t col_startndx = 1);
+
+
 // ------------------------------
 // Functions
 
-shared_ptr<ChunkedArray> VecAdd(shared_ptr<ChunkedArray> left_op, Datum right_op);
-shared_ptr<ChunkedArray> VecSub(shared_ptr<ChunkedArray> left_op, Datum right_op);
-shared_ptr<ChunkedArray> VecDiv(shared_ptr<ChunkedArray> left_op, Datum right_op);
-shared_ptr<ChunkedArray> VecMul(shared_ptr<ChunkedArray> left_op, Datum right_op);
-shared_ptr<ChunkedArray> VecPow(shared_ptr<ChunkedArray> left_op, Datum right_op);
+shared_ptr<ChunkedArray>
+VecAdd(shared_ptr<ChunkedArray> left_op, Datum right_op, ExecContext *exec_ctx = nullptr);
+shared_ptr<ChunkedArray>
+VecSub(shared_ptr<ChunkedArray> left_op, Datum right_op, ExecContext *exec_ctx = nullptr);
+shared_ptr<ChunkedArray>
+VecDiv(shared_ptr<ChunkedArray> left_op, Datum right_op, ExecContext *exec_ctx = nullptr);
+shared_ptr<ChunkedArray>
+VecMul(shared_ptr<ChunkedArray> left_op, Datum right_op, ExecContext *exec_ctx = nullptr);
+shared_ptr<ChunkedArray>
+VecPow(shared_ptr<ChunkedArray> left_op, Datum right_op, ExecContext *exec_ctx = nullptr);
+
+Result<double>
+MaxAbsDifference(shared_ptr<Table> left_table, shared_ptr<Table> right_table);
+
+// >> Alignment: `CopyMatchedRows` is `AlignRowsByKey`, then `GatherAlignedRows`. Keys are
+//    gene IDs (string or binary) or, on both sides, int32 gene codes (see `GeneDictionary`)
+Result<shared_ptr<Int64Array>>
+AlignRowsByKey(shared_ptr<ChunkedArray> ordered_ids, shared_ptr<ChunkedArray> src_keys);
+
+Result<shared_ptr<Table>>
+GatherAlignedRows( shared_ptr<Table>        src_table
+                  ,shared_ptr<Int64Array>   gather_ndxs
+                  ,shared_ptr<ChunkedArray> ordered_ids);
+
+// Reference for `GatherAlignedRows` (arrow's `Take` for every column); results are equal
+Result<shared_ptr<Table>>
+TakeAlignedRows( shared_ptr<Table>        src_table
+                ,shared_ptr<Int64Array>   gather_ndxs
+                ,shared_ptr<ChunkedArray> ordered_ids);
 
 Result<shared_ptr<Table>>
 CopyMatchedRows(shared_ptr<ChunkedArray> ordered_ids, shared_ptr<Table> src_table);
+
+
+// ------------------------------
+// Alignment cache
+//
+// The gather indices from `AlignRowsByKey` only depend on the source's key column and the
+// target order, so they are saved on local disk and reused: each entry is an uncompressed
+// IPC file with 1 nullable int64 column (its validity bitmap is the missing-row mask),
+// named by the fingerprints of both key columns. Entries are memory mapped when read, so
+// a repeat alignment is a fingerprint, a mapping, and `GatherAlignedRows`.
+
+// 64-bit hash of the values (and nulls) of a string or binary key column, in order; it
+// does not depend on how the column is chunked, and is stable across runs
+Result<uint64_t> KeyFingerprint(const ChunkedArray &key_col);
+
+// Safe to share between threads
+class AlignmentCache {
+  public:
+    explicit AlignmentCache(std::string cache_dirpath);
+
+    // same result as `AlignRowsByKey`, from the cache when possible
+    Result<shared_ptr<Int64Array>>
+    GatherIndices(shared_ptr<ChunkedArray> ordered_ids, shared_ptr<ChunkedArray> src_keys);
+
+    int64_t hit_count()  const { return hits;   }
+    int64_t miss_count() const { return misses; }
+
+  private:
+    Result<shared_ptr<Int64Array>>
+    LoadEntry(const std::string &entry_fpath, int64_t order_len, int64_t src_len);
+
+    Status
+    SaveEntry(const std::string &entry_fpath, shared_ptr<Int64Array> gather_ndxs);
+
+    std::string cache_dirpath;
+
+    // the target order rarely changes between calls, so its fingerprint is kept
+    std::mutex               order_lock;
+    shared_ptr<ChunkedArray> last_order;
+    uint64_t                 last_order_fp { 0 };
+
+    std::atomic<int64_t> hits   { 0 };
+    std::atomic<int64_t> misses { 0 };
+};
+
+Result<shared_ptr<Table>>
+CopyMatchedRows( shared_ptr<ChunkedArray>  ordered_ids
+                ,shared_ptr<Table>         src_table
+                ,AlignmentCache           &align_cache);
+
+
+// ------------------------------
+// Gene dictionary
+//
+// A key column can store int32 gene codes instead of gene IDs: code i is row i of a shared
+// gene annotation table, so matching and alignment compare integers instead of hashing
+// strings. An encoded key field keeps the dictionary's fingerprint (see `KeyFingerprint`)
+// in its "gene_dictionary" metadata, so codes from different dictionaries are not mixed.
+
+constexpr const char *gene_dictionary_key = "gene_dictionary";
+
+class GeneDictionary {
+  public:
+    // The key column (column 0) of `annotation_table`; its gene IDs must be unique
+    static Result<GeneDictionary> FromTable(shared_ptr<Table> annotation_table);
+
+    int64_t                  size()        const { return gene_ids->length(); }
+    uint64_t                 fingerprint() const { return gene_fp;            }
+    shared_ptr<ChunkedArray> ids()         const { return gene_ids;           }
+    shared_ptr<ChunkedArray> codes()       const { return gene_codes;         }
+
+    // Replace the key column of `src_table` with gene codes. Rows whose gene is not in the
+    // dictionary could never be aligned, so they are dropped (and counted).
+    Result<shared_ptr<Table>>
+    EncodeTable(shared_ptr<Table> src_table, int64_t *dropped_count = nullptr) const;
+
+    Result<shared_ptr<Table>>
+    DecodeTable(shared_ptr<Table> encoded_table) const;
+
+    // Whether the key column of `table_schema` holds codes from this dictionary
+    Status CheckEncoded(const Schema &table_schema) const;
+
+    // The target order to align `src_table` to (in `CopyMatchedRows`): the gene IDs, or
+    // their codes if `src_table` is encoded with this dictionary
+    Result<shared_ptr<ChunkedArray>> OrderFor(const Table &src_table) const;
+
+  private:
+    shared_ptr<ChunkedArray> gene_ids;
+    shared_ptr<ChunkedArray> gene_codes;
+    uint64_t                 gene_fp { 0 };
+};